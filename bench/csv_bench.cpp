@@ -0,0 +1,144 @@
+// Compares the datafile engines on one file: read_csv into a vector, upload_csv into persistently
+// mapped buffers and parse_csv_on_gpu.
+//
+// usage: csv_bench [file [column...]]
+//
+// Without a file, 10^7 rows with 4 random columns are generated in the temp directory.
+#include "csv.hpp"
+#include "csv_upload.hpp"
+#include "gpu_csv.hpp"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using namespace explot;
+
+std::filesystem::path generate(std::size_t rows, std::size_t columns)
+{
+  auto path = std::filesystem::temp_directory_path() / "explot_csv_bench.csv";
+  auto f = std::ofstream(path, std::ios::binary);
+  auto rng = std::mt19937(42);
+  auto dist = std::uniform_real_distribution<float>(-1000.0f, 1000.0f);
+  auto line = std::string();
+  for (auto row = 0uz; row < rows; ++row)
+  {
+    line.clear();
+    for (auto column = 0uz; column < columns; ++column)
+    {
+      fmt::format_to(std::back_inserter(line), "{}{}", column > 0 ? "," : "", dist(rng));
+    }
+    line.push_back('\n');
+    f.write(line.data(), static_cast<std::streamsize>(line.size()));
+  }
+  return path;
+}
+
+std::vector<float> read_back(std::span<const row_chunk> chunks, std::size_t row_size)
+{
+  auto result = std::vector<float>();
+  for (const auto &chunk : chunks)
+  {
+    const auto offset = result.size();
+    result.resize(offset + chunk.num_rows * row_size);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0,
+                       static_cast<GLsizeiptr>(chunk.num_rows * row_size * sizeof(float)),
+                       result.data() + offset);
+  }
+  return result;
+}
+
+template <typename F>
+double best_of_3(F f)
+{
+  auto best = std::chrono::duration<double>::max();
+  for (auto i = 0; i < 3; ++i)
+  {
+    glFinish();
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    glFinish();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start));
+  }
+  return best.count();
+}
+
+void report(const char *engine, double seconds, double megabytes, std::span<const float> result,
+            std::span<const float> reference)
+{
+  auto max_error = 0.0f;
+  for (auto i = 0uz; i < std::min(result.size(), reference.size()); ++i)
+  {
+    const auto scale = std::max(1.0f, std::abs(reference[i]));
+    max_error = std::max(max_error, std::abs(result[i] - reference[i]) / scale);
+  }
+  fmt::println("{:>8}: {:8.3f} s {:10.1f} MB/s  values {:>10} max rel. error {:g}{}", engine,
+               seconds, megabytes / seconds, result.size(), max_error,
+               result.size() == reference.size() ? "" : "  SIZE MISMATCH");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if (!glfwInit())
+  {
+    return 1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  auto *window = glfwCreateWindow(64, 64, "csv_bench", nullptr, nullptr);
+  if (window == nullptr)
+  {
+    fmt::println("failed to create an OpenGL 4.6 context");
+    return 1;
+  }
+  glfwMakeContextCurrent(window);
+  glewInit();
+  fmt::println("{}", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+  auto indices = std::vector<int>();
+  for (auto i = 2; i < argc; ++i)
+  {
+    indices.push_back(std::stoi(argv[i]));
+  }
+  if (indices.empty())
+  {
+    indices = {1, 2, 3, 4};
+  }
+  std::ranges::sort(indices);
+  const auto path = argc > 1 ? std::filesystem::path(argv[1]) : generate(10'000'000, 4);
+  const auto megabytes = static_cast<double>(std::filesystem::file_size(path)) / 1e6;
+  fmt::println("{}: {:.1f} MB, columns {}", path.c_str(), megabytes, fmt::join(indices, ","));
+
+  auto timebase = std::optional<time_point>();
+  auto shared = shared_timebase();
+  auto reference = std::vector<float>();
+  const auto cpu = best_of_3([&] { reference = read_csv(path, ',', indices, timebase); });
+  report("read_csv", cpu, megabytes, reference, reference);
+
+  auto chunks = std::vector<row_chunk>();
+  const auto mapped = best_of_3([&] { chunks = upload_csv(path, ',', indices, shared); });
+  report("mapped", mapped, megabytes, read_back(chunks, indices.size()), reference);
+
+  const auto gpu = best_of_3([&] { chunks = parse_csv_on_gpu(path, ',', indices, shared); });
+  report("gpu", gpu, megabytes, read_back(chunks, indices.size()), reference);
+
+  chunks.clear();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,274 @@
+// Compares the expression engines on representative function graphs: transform feedback and
+// compute shaders through data_for_function_2d and the VM on the CPU. Every expression is evaluated
+// at 10^3 up to max_points points and the points per second are reported with the time spent
+// compiling, which is the first run minus the best of the later ones for the GPU engines. Results
+// with at most 10^6 points are checked against the VM in double precision.
+//
+// usage: expr_bench [max_points]
+//
+// max_points is 10^8 by default. Without a display, the context is created with EGL on the null
+// platform of GLFW 3.4, so it runs headless with Mesa, e.g. LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe.
+#include "data.hpp"
+#include "expr_vm.hpp"
+#include "parse_commands.hpp"
+#include "program.hpp"
+#include "user_definitions.hpp"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+using namespace explot;
+
+struct bench_expression
+{
+  const char *name;
+  std::vector<std::string_view> definitions;
+  std::string_view plot;
+};
+
+const auto expressions = std::array{
+    bench_expression{"polynomial", {}, "plot 3*x**5 - 2*x**4 + x**3 - 7*x**2 + 5*x - 1"},
+    bench_expression{
+        "user functions",
+        {"f(a) = a*a + 1", "g(a) = f(a) / f(a + 1)", "h(a) = g(g(a) + a) * f(a / 3)"},
+        "plot h(x) + g(x)"},
+    bench_expression{"transcendental", {},
+                     "plot sin(x)*exp(-x*x/10) + log(1 + x*x)*cos(3*x) + atan(x) + sqrt(abs(x))"},
+    bench_expression{"conditional", {}, "plot x > 0 && x < 5 ? sqrt(x) : -x*x"}};
+
+// results with a relative error of at most this much, or an absolute one for values below 1, pass
+constexpr auto tolerance = 1e-3;
+
+// points up to this many are checked
+constexpr auto max_checked_points = 1'000'000u;
+
+constexpr auto min_x = -10.0f;
+constexpr auto max_x = 10.0f;
+
+template <typename F>
+double seconds(F f)
+{
+  glFinish();
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  glFinish();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename F>
+double best_of_3(F f)
+{
+  auto best = seconds(f);
+  for (auto i = 0; i < 2; ++i)
+  {
+    best = std::min(best, seconds(f));
+  }
+  return best;
+}
+
+std::vector<float> read_back(gl_id vbo, std::size_t num_values)
+{
+  auto result = std::vector<float>(num_values);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glGetBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(num_values * sizeof(float)),
+                     result.data());
+  return result;
+}
+
+// Evaluates the points (x, e(x)) of num_points samples of [min_x, max_x] like the GPU engines. Only
+// the points of the last chunk are kept in points. Points, which are checked, are one chunk.
+void evaluate_on_cpu(const vm_program &program, uint32_t num_points, std::vector<float> &points)
+{
+  const auto chunk = num_points <= max_checked_points ? num_points : 1u << 16;
+  const auto step_x = (max_x - min_x) / static_cast<float>(num_points - 1);
+  auto xs = std::vector<float>(std::min(chunk, num_points));
+  const auto inputs = std::vector<vm_column>(program.inputs.size(), {xs.data(), 1});
+  points.resize(xs.size() * program.outputs.size());
+  for (auto first = 0u; first < num_points; first += chunk)
+  {
+    const auto n = std::min(chunk, num_points - first);
+    for (auto i = 0u; i < n; ++i)
+    {
+      xs[i] = min_x + static_cast<float>(first + i) * step_x;
+    }
+    evaluate(program, inputs, first, n, points);
+  }
+}
+
+struct check_result
+{
+  double max_error = 0.0;
+  bool passed = true;
+};
+
+// compares the y of every point with the VM in double precision at the x of the point
+check_result check(const vm_program &program, std::span<const float> points)
+{
+  const auto num_points = static_cast<uint32_t>(points.size() / 2);
+  auto xs = std::vector<double>(num_points);
+  for (auto i = 0u; i < num_points; ++i)
+  {
+    xs[i] = points[2 * i];
+  }
+  const auto inputs = std::vector<vm_column_fp64>(program.inputs.size(), {xs.data(), 1});
+  auto reference = std::vector<double>(2uz * num_points);
+  evaluate_fp64(program, inputs, 0, num_points, reference);
+
+  auto result = check_result();
+  for (auto i = 0u; i < num_points; ++i)
+  {
+    const auto y = static_cast<double>(points[2 * i + 1]);
+    const auto expected = reference[2 * i + 1];
+    if (std::isnan(y) || std::isnan(expected))
+    {
+      result.passed = result.passed && std::isnan(y) == std::isnan(expected);
+      continue;
+    }
+    const auto error = std::abs(y - expected) / std::max(1.0, std::abs(expected));
+    result.max_error = std::max(result.max_error, error);
+  }
+  result.passed = result.passed && result.max_error <= tolerance;
+  return result;
+}
+
+void report(const char *engine, uint32_t num_points, double compile, double run,
+            std::optional<check_result> checked)
+{
+  fmt::println("  {:>9} {:>10} points: {:9.3f} Mpoints/s  compile {:8.2f} ms  {}", engine,
+               num_points, num_points / run / 1e6, compile * 1e3,
+               checked ? fmt::format("max rel. error {:.2e} {}", checked->max_error,
+                                     checked->passed ? "ok" : "FAILED")
+                       : std::string("not checked"));
+}
+
+// Returns whether the results of all engines are within the tolerance.
+bool run(const bench_expression &b, uint32_t max_points)
+{
+  for (auto definition : b.definitions)
+  {
+    auto cmd = parse_command(definition);
+    if (!cmd || !std::holds_alternative<user_definition>(*cmd))
+    {
+      fmt::println("{}: {}", definition, cmd ? "not a definition" : cmd.error());
+      return false;
+    }
+    add_definition(std::get<user_definition>(std::move(*cmd)));
+  }
+  auto cmd = parse_command(b.plot);
+  if (!cmd || !std::holds_alternative<plot_command_2d>(*cmd))
+  {
+    fmt::println("{}: {}", b.plot, cmd ? "not a 2d plot" : cmd.error());
+    return false;
+  }
+  auto plot = std::get<plot_command_2d>(std::move(*cmd));
+  plot.precision = precision_setting::single;
+  plot.sampling.adaptive = false;
+  const auto &e = std::get<expr>(plot.graphs.front().data);
+  const auto mark = mark_type_2d::lines;
+  const auto xrange = range_setting{min_x, max_x};
+  fmt::println("{}: {}", b.name, b.plot.substr(5));
+
+  const auto exprs = std::array{expr(var{"x"}), e};
+  auto program = vm_program();
+  const auto vm_compile = best_of_3([&] { program = compile(exprs); });
+
+  auto passed = true;
+  for (auto num_points = 1000u; num_points <= max_points; num_points *= 10)
+  {
+    const auto checked = num_points <= max_checked_points;
+    for (auto engine : {expression_engine::transform_feedback, expression_engine::compute})
+    {
+      plot.evaluation.engine = engine;
+      auto data = std::optional<std::tuple<vbo_handle, seq_data_desc>>();
+      auto evaluate = [&]
+      {
+        data.reset();
+        data = data_for_function_2d(plot, mark, e, num_points, xrange);
+      };
+      clear_program_cache();
+      const auto first = seconds(evaluate);
+      const auto best = best_of_3(evaluate);
+      auto result = std::optional<check_result>();
+      if (checked)
+      {
+        result = check(program, read_back(std::get<0>(*data), 2uz * num_points));
+        passed = passed && result->passed;
+      }
+      report(engine == expression_engine::compute ? "compute" : "feedback", num_points,
+             std::max(0.0, first - best), best, result);
+    }
+
+    auto points = std::vector<float>();
+    const auto best = best_of_3([&] { evaluate_on_cpu(program, num_points, points); });
+    auto result = std::optional<check_result>();
+    if (checked)
+    {
+      result = check(program, points);
+      passed = passed && result->passed;
+    }
+    report("vm", num_points, vm_compile, best, result);
+  }
+  return passed;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  // at most 10^9, so that the sizes do not overflow
+  const auto max_points =
+      argc > 1 ? static_cast<uint32_t>(std::min(std::stoul(argv[1]), 1'000'000'000ul))
+               : 100'000'000u;
+  const auto headless = std::getenv("DISPLAY") == nullptr
+                        && std::getenv("WAYLAND_DISPLAY") == nullptr;
+#if GLFW_VERSION_MAJOR > 3 || GLFW_VERSION_MINOR >= 4
+  if (headless)
+  {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
+#endif
+  if (!glfwInit())
+  {
+    return 1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  if (headless)
+  {
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+  }
+  auto *window = glfwCreateWindow(64, 64, "expr_bench", nullptr, nullptr);
+  if (window == nullptr)
+  {
+    fmt::println("failed to create an OpenGL 4.6 context");
+    return 1;
+  }
+  glfwMakeContextCurrent(window);
+  glewInit();
+  fmt::println("{}", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+
+  auto passed = true;
+  for (const auto &b : expressions)
+  {
+    passed = run(b, max_points) && passed;
+  }
+
+  const auto stats = program_cache_statistics();
+  fmt::println("program cache: {} hits, {} misses ({} loaded from disk), {} clones", stats.hits,
+               stats.misses, stats.loaded, stats.clones);
+  clear_program_cache();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return passed ? 0 : 1;
+}
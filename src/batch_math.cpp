@@ -0,0 +1,610 @@
+#include "batch_math.hpp"
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+
+// the loops are vectorized for every instruction set, which needs ifunc support to be dispatched.
+// flatten inlines the helpers into the clones, which the inliner does not do on its own for large
+// ones like pow_.
+#if defined(__x86_64__) && defined(__linux__)
+#define EXPLOT_BATCH_KERNEL [[gnu::target_clones("avx512f", "avx2", "default"), gnu::flatten]]
+#else
+#define EXPLOT_BATCH_KERNEL
+#endif
+
+namespace
+{
+// The polynomials are the single precision approximations of the Cephes library. Everything is
+// branch free, conditions are selects, so that the compiler can vectorize the loops.
+
+constexpr auto pi = std::numbers::pi_v<float>;
+constexpr auto pi_2 = pi / 2.0f;
+constexpr auto pi_4 = pi / 4.0f;
+// |x| up to which the reduction of sin, cos and tan by multiples of pi/2 is accurate
+constexpr auto trig_limit = 8192.0f;
+
+float as_float(int32_t i) { return std::bit_cast<float>(i); }
+int32_t as_int(float f) { return std::bit_cast<int32_t>(f); }
+
+float abs_(float x) { return as_float(as_int(x) & 0x7fffffff); }
+float copysign_(float x, float sign)
+{
+  return as_float((as_int(x) & 0x7fffffff) | (as_int(sign) & static_cast<int32_t>(0x80000000u)));
+}
+
+// rounds to the nearest integer for |x| < 2^22
+float round_(float x)
+{
+  constexpr auto magic = 0x1.8p23f;
+  return (x + magic) - magic;
+}
+
+bool is_finite(float x) { return abs_(x) <= std::numeric_limits<float>::max(); }
+float min_(float a, float b) { return a < b ? a : b; }
+float max_(float a, float b) { return a < b ? b : a; }
+
+// x * 2^n for -252 <= n <= 254, in two steps, so that neither 2^n nor results below the smallest
+// normal overflow or become 0
+float scale(float x, int32_t n)
+{
+  const auto half = n >> 1;
+  return x * as_float((half + 127) << 23) * as_float((n - half + 127) << 23);
+}
+
+// for -87.3 < x < 88.7
+float exp_(float x)
+{
+  const auto n = round_(x * std::numbers::log2e_v<float>);
+  auto r = x - n * 0.693359375f;
+  r = r - n * -2.12194440e-4f;
+  auto p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  return scale(p, static_cast<int32_t>(n));
+}
+
+// for normal positive x
+float log_(float x)
+{
+  const auto bits = as_int(x);
+  auto e = ((bits >> 23) & 0xff) - 126;
+  // x = m * 2^e with 0.5 <= m < 1
+  const auto m = as_float((bits & 0x007fffff) | 0x3f000000);
+  const auto small = m < std::numbers::sqrt2_v<float> / 2.0f;
+  e = small ? e - 1 : e;
+  const auto f = small ? m + m - 1.0f : m - 1.0f;
+  const auto z = f * f;
+  auto p = 7.0376836292e-2f;
+  p = p * f - 1.1514610310e-1f;
+  p = p * f + 1.1676998740e-1f;
+  p = p * f - 1.2420140846e-1f;
+  p = p * f + 1.4249322787e-1f;
+  p = p * f - 1.6668057665e-1f;
+  p = p * f + 2.0000714765e-1f;
+  p = p * f - 2.4999993993e-1f;
+  p = p * f + 3.3333331174e-1f;
+  const auto fe = static_cast<float>(e);
+  auto y = p * f * z;
+  y += -2.12194440e-4f * fe;
+  y += -0.5f * z;
+  return f + y + 0.693359375f * fe;
+}
+
+struct reduced
+{
+  // x - quadrant * pi/2, in [-pi/4, pi/4]
+  float r;
+  int32_t quadrant;
+};
+
+// For |x| <= trig_limit. The reduction is done in double with pi/2 split in two parts, the product
+// of the first one with the quadrant is exact. Results close to 0 would lose most of their bits in
+// float.
+reduced reduce_(float x)
+{
+  const auto n = round_(x * (2.0f / pi));
+  const auto nd = static_cast<double>(n);
+  auto r = static_cast<double>(x) - nd * 1.5707963267341256;
+  r = r - nd * 6.077100506506192e-11;
+  return reduced{static_cast<float>(r), static_cast<int32_t>(n) & 3};
+}
+
+float sin_poly(float r)
+{
+  const auto z = r * r;
+  auto p = -1.9515295891e-4f;
+  p = p * z + 8.3321608736e-3f;
+  p = p * z - 1.6666654611e-1f;
+  return r + r * z * p;
+}
+
+float cos_poly(float r)
+{
+  const auto z = r * r;
+  auto p = 2.443315711809948e-5f;
+  p = p * z - 1.388731625493765e-3f;
+  p = p * z + 4.166664568298827e-2f;
+  return 1.0f - 0.5f * z + z * z * p;
+}
+
+float sin_(float x)
+{
+  const auto [r, q] = reduce_(x);
+  const auto v = (q & 1) != 0 ? cos_poly(r) : sin_poly(r);
+  return (q & 2) != 0 ? -v : v;
+}
+
+float cos_(float x)
+{
+  const auto [r, q] = reduce_(x);
+  const auto v = (q & 1) != 0 ? sin_poly(r) : cos_poly(r);
+  return ((q + 1) & 2) != 0 ? -v : v;
+}
+
+float tan_(float x)
+{
+  const auto [r, q] = reduce_(x);
+  const auto s = sin_poly(r);
+  const auto c = cos_poly(r);
+  return (q & 1) != 0 ? -c / s : s / c;
+}
+
+// for |t| <= tan(pi/8)
+float atan_poly(float t)
+{
+  const auto z = t * t;
+  auto p = 8.05374449538e-2f;
+  p = p * z - 1.38776856032e-1f;
+  p = p * z + 1.99777106478e-1f;
+  p = p * z - 3.33329491539e-1f;
+  return p * z * t + t;
+}
+
+float atan_(float x)
+{
+  const auto a = abs_(x);
+  const auto big = a > 2.414213562373095f;
+  const auto mid = a > 0.4142135623730950f;
+  const auto offset = big ? pi_2 : (mid ? pi_4 : 0.0f);
+  const auto t = big ? -1.0f / a : (mid ? (a - 1.0f) / (a + 1.0f) : a);
+  return copysign_(offset + atan_poly(t), x);
+}
+
+// for finite a and b, which are not both 0
+float atan2_(float a, float b)
+{
+  const auto ay = abs_(a);
+  const auto ax = abs_(b);
+  const auto t = min_(ax, ay) / max_(ax, ay);
+  auto r = atan_(t);
+  r = ay > ax ? pi_2 - r : r;
+  r = b < 0.0f ? pi - r : r;
+  return copysign_(r, a);
+}
+
+// for |x| <= 0.5
+float asin_poly(float x)
+{
+  const auto z = x * x;
+  auto p = 4.2163199048e-2f;
+  p = p * z + 2.4181311049e-2f;
+  p = p * z + 4.5470025998e-2f;
+  p = p * z + 7.4953002686e-2f;
+  p = p * z + 1.6666752422e-1f;
+  return p * z * x + x;
+}
+
+// for |x| <= 1
+float asin_(float x)
+{
+  const auto a = abs_(x);
+  const auto big = a > 0.5f;
+  const auto p = asin_poly(big ? std::sqrt(0.5f * (1.0f - a)) : a);
+  return copysign_(big ? pi_2 - 2.0f * p : p, x);
+}
+
+// for |x| <= 1
+float acos_(float x)
+{
+  const auto small = abs_(x) <= 0.5f;
+  const auto p = asin_poly(small ? x : std::sqrt(0.5f * (1.0f - abs_(x))));
+  return small ? pi_2 - p : (x > 0.0f ? 2.0f * p : pi - 2.0f * p);
+}
+
+// for |x| < 88
+float sinh_(float x)
+{
+  const auto a = abs_(x);
+  const auto z = x * x;
+  auto p = 2.03721912945e-4f;
+  p = p * z + 8.33028376239e-3f;
+  p = p * z + 1.66667160211e-1f;
+  const auto e = exp_(a);
+  const auto big = copysign_(0.5f * e - 0.5f / e, x);
+  return a > 1.0f ? big : p * z * x + x;
+}
+
+// for |x| < 88
+float cosh_(float x)
+{
+  const auto e = exp_(abs_(x));
+  return 0.5f * e + 0.5f / e;
+}
+
+float tanh_(float x)
+{
+  const auto a = abs_(x);
+  const auto z = x * x;
+  auto p = -5.70498872745e-3f;
+  p = p * z + 2.06390887954e-2f;
+  p = p * z - 5.37397155531e-2f;
+  p = p * z + 1.33314422036e-1f;
+  p = p * z - 3.33332819422e-1f;
+  // tanh is 1 in float above 9
+  const auto big = copysign_(1.0f - 2.0f / (exp_(min_(2.0f * a, 18.0f)) + 1.0f), x);
+  return a >= 0.625f ? big : p * z * x + x;
+}
+
+// for |x| < 1e18
+float asinh_(float x)
+{
+  const auto a = abs_(x);
+  const auto z = x * x;
+  auto p = 2.0122003309e-2f;
+  p = p * z - 4.2699340972e-2f;
+  p = p * z + 7.4847586088e-2f;
+  p = p * z - 1.6666288134e-1f;
+  const auto big = copysign_(log_(a + std::sqrt(z + 1.0f)), x);
+  return a >= 0.5f ? big : p * z * x + x;
+}
+
+// for 1 <= x < 1e18
+float acosh_(float x)
+{
+  const auto z = x - 1.0f;
+  auto p = 1.7596881071e-3f;
+  p = p * z - 7.5272886713e-3f;
+  p = p * z + 2.6454905019e-2f;
+  p = p * z - 1.1784741703e-1f;
+  p = p * z + 1.4142135263e0f;
+  const auto big = log_(x + std::sqrt(z * (x + 1.0f)));
+  return z >= 0.5f ? big : p * std::sqrt(z);
+}
+
+// for |x| < 1
+float atanh_(float x)
+{
+  const auto a = abs_(x);
+  const auto z = x * x;
+  auto p = 1.81740078349e-1f;
+  p = p * z + 8.24370301058e-2f;
+  p = p * z + 1.46691431730e-1f;
+  p = p * z + 1.99782164500e-1f;
+  p = p * z + 3.33337300303e-1f;
+  const auto big = copysign_(0.5f * log_((1.0f + a) / (1.0f - a)), x);
+  return a >= 0.5f ? big : p * z * x + x;
+}
+
+bool is_normal_positive(float x)
+{
+  return x >= std::numeric_limits<float>::min() && x <= std::numeric_limits<float>::max();
+}
+
+bool is_integer(float x) { return std::floor(x) == x; }
+
+// y * log(|x|) is the argument of exp_fp64, whose result is a normal float in this range
+bool pow_in_range(float x, float y)
+{
+  const auto a = abs_(x);
+  const auto l = y * log_(a);
+  return is_finite(y) && is_normal_positive(a) && (x > 0.0f || is_integer(y)) && l > -87.0f
+         && l < 88.5f;
+}
+
+// log for normal positive x in double precision. log(m) = 2 atanh((m - 1) / (m + 1)) with
+// sqrt(1/2) <= m < sqrt(2), whose series converges fast.
+double log_fp64(float x)
+{
+  // the reduction is exact in float, which keeps the loops free of 64 bit integers
+  const auto bits = as_int(x);
+  auto e = static_cast<float>(((bits >> 23) & 0xff) - 127);
+  auto m = as_float((bits & 0x007fffff) | 0x3f800000);
+  const auto big = m > std::numbers::sqrt2_v<float>;
+  e = big ? e + 1.0f : e;
+  m = big ? 0.5f * m : m;
+  const auto s = (static_cast<double>(m) - 1.0) / (static_cast<double>(m) + 1.0);
+  const auto z = s * s;
+  auto p = 1.0 / 15.0;
+  p = p * z + 1.0 / 13.0;
+  p = p * z + 1.0 / 11.0;
+  p = p * z + 1.0 / 9.0;
+  p = p * z + 1.0 / 7.0;
+  p = p * z + 1.0 / 5.0;
+  p = p * z + 1.0 / 3.0;
+  p = p * z + 1.0;
+  return 2.0 * s * p + static_cast<double>(e) * std::numbers::ln2;
+}
+
+// exp for -87 < x < 88.5 in double precision, with a Taylor polynomial of x - n * log(2)
+double exp_fp64(double x)
+{
+  const auto n = round_(static_cast<float>(x * std::numbers::log2e));
+  const auto r = x - static_cast<double>(n) * std::numbers::ln2;
+  // Taylor polynomial up to r^11 / 11!
+  auto p = 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = (p * r + 1.0) * r + 1.0;
+  // 2^n in two factors, which are normal floats
+  const auto e = static_cast<int32_t>(n);
+  const auto half = e >> 1;
+  return p * static_cast<double>(as_float((half + 127) << 23))
+         * static_cast<double>(as_float((e - half + 127) << 23));
+}
+
+// pow is evaluated in double precision, because the error of y * log(x) grows with y
+float pow_(float x, float y)
+{
+  const auto a = abs_(x);
+  const auto r = static_cast<float>(exp_fp64(static_cast<double>(y) * log_fp64(a)));
+  // a negative x has an integer y, whose parity is the sign
+  const auto odd = x < 0.0f && !is_integer(0.5f * y);
+  return odd ? -r : r;
+}
+
+// Elements with x outside of the fast range are evaluated again with f.
+template <typename P, typename F>
+[[gnu::noinline]] void fix_up(const float *x, float *result, std::size_t n, P in_range, F f)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    if (!in_range(x[i]))
+    {
+      result[i] = f(x[i]);
+    }
+  }
+}
+
+template <typename P, typename F>
+[[gnu::noinline]] void fix_up(const float *a, const float *b, float *result, std::size_t n,
+                              P in_range, F f)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    if (!in_range(a[i], b[i]))
+    {
+      result[i] = f(a[i], b[i]);
+    }
+  }
+}
+
+float std_sin(float x) { return std::sin(x); }
+float std_cos(float x) { return std::cos(x); }
+float std_tan(float x) { return std::tan(x); }
+float std_exp(float x) { return std::exp(x); }
+float std_log(float x) { return std::log(x); }
+float std_log10(float x) { return std::log10(x); }
+float std_sinh(float x) { return std::sinh(x); }
+float std_cosh(float x) { return std::cosh(x); }
+float std_asin(float x) { return std::asin(x); }
+float std_acos(float x) { return std::acos(x); }
+float std_asinh(float x) { return std::asinh(x); }
+float std_acosh(float x) { return std::acosh(x); }
+float std_atanh(float x) { return std::atanh(x); }
+float std_atan2(float a, float b) { return std::atan2(a, b); }
+float std_pow(float a, float b) { return std::pow(a, b); }
+
+bool in_exp_range(float x) { return x > -87.3f && x < 88.7f; }
+bool in_trig_range(float x) { return abs_(x) <= trig_limit; }
+bool in_unit_range(float x) { return abs_(x) <= 1.0f; }
+bool in_hyperbolic_range(float x) { return abs_(x) < 88.0f; }
+} // namespace
+
+namespace explot
+{
+EXPLOT_BATCH_KERNEL void batch_abs(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = abs_(x[i]);
+  }
+}
+
+EXPLOT_BATCH_KERNEL void batch_acos(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = acos_(x[i]);
+  }
+  fix_up(x, result, n, in_unit_range, std_acos);
+}
+
+EXPLOT_BATCH_KERNEL void batch_acosh(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = acosh_(x[i]);
+  }
+  fix_up(x, result, n, [](float v) { return v >= 1.0f && v < 1e18f; }, std_acosh);
+}
+
+EXPLOT_BATCH_KERNEL void batch_asin(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = asin_(x[i]);
+  }
+  fix_up(x, result, n, in_unit_range, std_asin);
+}
+
+EXPLOT_BATCH_KERNEL void batch_asinh(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = asinh_(x[i]);
+  }
+  fix_up(x, result, n, [](float v) { return abs_(v) < 1e18f; }, std_asinh);
+}
+
+EXPLOT_BATCH_KERNEL void batch_atan(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = atan_(x[i]);
+  }
+}
+
+EXPLOT_BATCH_KERNEL void batch_atanh(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = atanh_(x[i]);
+  }
+  fix_up(x, result, n, [](float v) { return abs_(v) < 1.0f; }, std_atanh);
+}
+
+EXPLOT_BATCH_KERNEL void batch_ceil(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = std::ceil(x[i]);
+  }
+}
+
+EXPLOT_BATCH_KERNEL void batch_cos(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = cos_(x[i]);
+  }
+  fix_up(x, result, n, in_trig_range, std_cos);
+}
+
+EXPLOT_BATCH_KERNEL void batch_cosh(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = cosh_(x[i]);
+  }
+  fix_up(x, result, n, in_hyperbolic_range, std_cosh);
+}
+
+EXPLOT_BATCH_KERNEL void batch_exp(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = exp_(x[i]);
+  }
+  fix_up(x, result, n, in_exp_range, std_exp);
+}
+
+EXPLOT_BATCH_KERNEL void batch_floor(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = std::floor(x[i]);
+  }
+}
+
+EXPLOT_BATCH_KERNEL void batch_log(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = log_(x[i]);
+  }
+  fix_up(x, result, n, is_normal_positive, std_log);
+}
+
+EXPLOT_BATCH_KERNEL void batch_log10(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = log_(x[i]) * std::numbers::log10e_v<float>;
+  }
+  fix_up(x, result, n, is_normal_positive, std_log10);
+}
+
+EXPLOT_BATCH_KERNEL void batch_sgn(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = copysign_(1.0f, x[i]);
+  }
+}
+
+EXPLOT_BATCH_KERNEL void batch_sin(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = sin_(x[i]);
+  }
+  fix_up(x, result, n, in_trig_range, std_sin);
+}
+
+EXPLOT_BATCH_KERNEL void batch_sinh(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = sinh_(x[i]);
+  }
+  fix_up(x, result, n, in_hyperbolic_range, std_sinh);
+}
+
+EXPLOT_BATCH_KERNEL void batch_sqrt(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = std::sqrt(x[i]);
+  }
+}
+
+EXPLOT_BATCH_KERNEL void batch_tan(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = tan_(x[i]);
+  }
+  fix_up(x, result, n, in_trig_range, std_tan);
+}
+
+EXPLOT_BATCH_KERNEL void batch_tanh(const float *x, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = tanh_(x[i]);
+  }
+}
+
+EXPLOT_BATCH_KERNEL void batch_atan2(const float *a, const float *b, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = atan2_(a[i], b[i]);
+  }
+  fix_up(
+      a, b, result, n, [](float y, float x)
+      { return is_finite(y) && is_finite(x) && (y != 0.0f || x != 0.0f); }, std_atan2);
+}
+
+EXPLOT_BATCH_KERNEL void batch_pow(const float *a, const float *b, float *result, std::size_t n)
+{
+  for (auto i = 0uz; i < n; ++i)
+  {
+    result[i] = pow_(a[i], b[i]);
+  }
+  fix_up(a, b, result, n, pow_in_range, std_pow);
+}
+} // namespace explot
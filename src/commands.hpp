@@ -4,8 +4,9 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <optional>
 #include "range_setting.hpp"
-#include "box.hpp"
+#include "expr.hpp"
 #include "enum_utilities.hpp"
 #include "line_type.hpp"
 
@@ -15,76 +16,6 @@ struct quit_command final
 {
 };
 
-struct literal_expr final
-{
-  float value;
-};
-
-struct data_ref
-{
-  int idx;
-};
-
-struct var
-{
-  std::string name;
-};
-
-struct user_var_ref
-{
-  uint32_t idx;
-};
-
-using expr = std::variant<literal_expr, box<struct unary_op>, box<struct binary_op>,
-                          box<struct unary_builtin_call>, box<struct binary_builtin_call>,
-                          box<struct user_function_call>, user_var_ref, var, data_ref>;
-
-enum class unary_operator
-{
-  minus,
-  plus
-};
-
-struct unary_op final
-{
-  unary_operator op;
-  expr operand;
-};
-
-enum class binary_operator
-{
-  plus,
-  minus,
-  mult,
-  div
-};
-
-struct binary_op final
-{
-  expr lhs;
-  binary_operator op;
-  expr rhs;
-};
-
-struct unary_builtin_call
-{
-  std::string name;
-  expr arg;
-};
-
-struct binary_builtin_call
-{
-  std::string name;
-  expr arg1;
-  expr arg2;
-};
-
-struct user_function_call
-{
-  uint32_t idx;
-  std::vector<expr> args;
-};
-
 struct csv_data final
 {
   std::string path;
@@ -97,6 +28,14 @@ struct parametric_data_2d final
   expr expressions[2];
 };
 
+struct live_data final
+{
+  std::filesystem::path socket;
+  std::vector<expr> expressions;
+  // keep only the last window points
+  std::optional<uint32_t> window;
+};
+
 enum struct mark_type_2d
 {
   points,
@@ -112,7 +51,7 @@ enum struct mark_type_3d
   pm3d
 };
 
-using data_source_2d = std::variant<expr, csv_data, parametric_data_2d>;
+using data_source_2d = std::variant<expr, csv_data, parametric_data_2d, live_data>;
 
 struct graph_desc_2d final
 {
@@ -128,6 +67,46 @@ enum class data_type : char
   time
 };
 
+enum class datafile_engine : char
+{
+  cpu,
+  // experimental, parses numeric fields with compute shaders
+  gpu
+};
+
+enum class expression_engine : char
+{
+  transform_feedback,
+  // experimental, evaluates expressions with compute shaders
+  compute
+};
+
+struct evaluation_setting final
+{
+  expression_engine engine = expression_engine::transform_feedback;
+  // local size of the compute shaders
+  uint32_t workgroup_size = 64;
+  // Upper bound of the bytes written by one draw or dispatch and of temporary buffers. Larger
+  // results are evaluated in chunks. Set with set evaluation budget, in megabytes.
+  std::size_t budget = 256uz << 20;
+};
+
+enum class precision_setting : char
+{
+  single,
+  // function graphs are evaluated in double precision on the CPU
+  fp64
+};
+
+// With adaptive sampling, the samples of a function are only the initial points. Intervals are
+// subdivided until the curve is within half a pixel of its line segments.
+struct sampling_setting final
+{
+  bool adaptive = false;
+  // upper bound of the points of a graph
+  uint32_t max_points = 1u << 20;
+};
+
 struct samples_setting final
 {
   uint32_t x = 100;
@@ -145,6 +124,12 @@ struct plot_command_2d final
   samples_setting samples;
   samples_setting isosamples;
   char separator;
+  datafile_engine engine;
+  // bytes of points of datafiles, which are kept for later plots
+  std::size_t datafile_cache;
+  evaluation_setting evaluation;
+  sampling_setting sampling;
+  precision_setting precision;
 };
 
 struct parametric_data_3d final
@@ -172,6 +157,9 @@ struct plot_command_3d final
   samples_setting samples;
   samples_setting isosamples;
   char separator;
+  datafile_engine engine;
+  std::size_t datafile_cache;
+  evaluation_setting evaluation;
 };
 
 struct multiplot_setting
@@ -191,14 +179,23 @@ enum class settings_id
   xdata,
   hidden3d,
   pallette_rgbformulae,
-  multiplot
+  multiplot,
+  datafile_engine,
+  evaluation,
+  sampling,
+  precision,
+  evaluation_budget,
+  datafile_cache
 };
 
 using all_settings =
     enum_sequence<settings_id, settings_id::samples, settings_id::isosamples,
                   settings_id::datafile_separator, settings_id::xrange, settings_id::parametric,
                   settings_id::timefmt, settings_id::xdata, settings_id::hidden3d,
-                  settings_id::pallette_rgbformulae, settings_id::multiplot>;
+                  settings_id::pallette_rgbformulae, settings_id::multiplot,
+                  settings_id::datafile_engine, settings_id::evaluation,
+                  settings_id::sampling, settings_id::precision,
+                  settings_id::evaluation_budget, settings_id::datafile_cache>;
 
 template <settings_id>
 struct settings_type
@@ -266,6 +263,44 @@ struct settings_type<settings_id::multiplot>
   using type = multiplot_setting;
 };
 
+template <>
+struct settings_type<settings_id::datafile_engine>
+{
+  using type = datafile_engine;
+};
+
+template <>
+struct settings_type<settings_id::evaluation>
+{
+  using type = evaluation_setting;
+};
+
+template <>
+struct settings_type<settings_id::sampling>
+{
+  using type = sampling_setting;
+};
+
+template <>
+struct settings_type<settings_id::precision>
+{
+  using type = precision_setting;
+};
+
+// in megabytes
+template <>
+struct settings_type<settings_id::evaluation_budget>
+{
+  using type = uint32_t;
+};
+
+// in megabytes
+template <>
+struct settings_type<settings_id::datafile_cache>
+{
+  using type = uint32_t;
+};
+
 template <settings_id id>
 using settings_type_t = typename settings_type<id>::type;
 
@@ -324,9 +359,27 @@ struct load_command
   std::filesystem::path path;
 };
 
+// a slider for the constant variable name in plots, which use it
+struct bind_command
+{
+  std::string name;
+  float lower;
+  float upper;
+};
+
+// sweeps the constant variable name from from to to and back, with fps updates per second
+struct animate_command
+{
+  std::string name;
+  float from;
+  float to;
+  float fps;
+};
+
 using command =
     std::variant<quit_command, plot_command_2d, plot_command_3d, user_definition, set_command,
-                 show_command, unset_command, cd_command, pwd_command, load_command>;
+                 show_command, unset_command, cd_command, pwd_command, load_command, bind_command,
+                 animate_command>;
 
 inline bool is_quit_command(const command &cmd)
 {
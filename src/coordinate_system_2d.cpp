@@ -102,7 +102,8 @@ void main()
 
 auto program_for_tics()
 {
-  return make_program(tics_geometry_shader_src, tics_vertex_shader_src, fragment_shader_src);
+  return clone_program(
+      make_program(tics_geometry_shader_src, tics_vertex_shader_src, fragment_shader_src));
 }
 
 lines_state_2d make_axis(gl_id vbo)
@@ -14,7 +14,8 @@ namespace
 {
 using namespace explot;
 
-float parse_field(const char *s, const char *e, std::optional<time_point> &timebase)
+float parse_field(const char *s, const char *e, std::optional<time_point> &timebase,
+                  shared_timebase *shared = nullptr)
 {
   auto value = 0.0f;
   auto [ptr, ec] = std::from_chars(s, e, value);
@@ -29,7 +30,10 @@ float parse_field(const char *s, const char *e, std::optional<time_point> &timeb
     date::from_stream(ss, settings::timefmt(), tp);
     if (!ss.fail())
     {
-      timebase = timebase.value_or(tp);
+      if (!timebase.has_value())
+      {
+        timebase = shared != nullptr ? shared->get_or_set(tp) : tp;
+      }
       auto d = std::chrono::duration<float>(tp - timebase.value());
       return d.count();
     }
@@ -77,10 +81,72 @@ void read_csv_impl(std::ifstream &f, char delim, auto handle_field, auto handle_
   }
 }
 
+// keeps the fields of a row that are selected by indices. Missing fields are filled with 0.
+template <typename Output>
+struct row_reader
+{
+  std::span<const int> indices;
+  std::optional<time_point> &timebase;
+  Output &result;
+  shared_timebase *shared = nullptr;
+  std::size_t idx = 0uz;
+  int csv_idx = 0;
+
+  void field(const char *s, const char *e)
+  {
+    ++csv_idx; // this is 1-based
+    if (idx < indices.size() && csv_idx == indices[idx])
+    {
+      result.push_back(parse_field(s, e, timebase, shared));
+      ++idx;
+    }
+  }
+
+  void end_of_line()
+  {
+    for (; idx < indices.size(); ++idx)
+    {
+      result.push_back(0.0f);
+    }
+    idx = 0uz;
+    csv_idx = 0;
+  }
+};
+
+// writes to the chunks returned by next_chunk. Chunks hold whole rows, so a row is never split.
+struct chunk_writer
+{
+  const csv_chunk_sink &next_chunk;
+  std::span<float> chunk;
+  std::size_t size = 0uz;
+
+  void push_back(float value)
+  {
+    if (size == chunk.size())
+    {
+      chunk = next_chunk(chunk);
+      size = 0uz;
+    }
+    chunk[size++] = value;
+  }
+};
+
 } // namespace
 
 namespace explot
 {
+time_point shared_timebase::get_or_set(time_point tp)
+{
+  auto lock = std::scoped_lock(mutex);
+  value = value.value_or(tp);
+  return *value;
+}
+
+std::optional<time_point> shared_timebase::get()
+{
+  auto lock = std::scoped_lock(mutex);
+  return value;
+}
 
 std::vector<float> read_csv(const std::filesystem::path &p, char delim, std::span<int> indices,
                             std::optional<time_point> &timebase)
@@ -89,32 +155,76 @@ std::vector<float> read_csv(const std::filesystem::path &p, char delim, std::spa
 
   auto f = std::ifstream(p, std::ios::binary);
 
-  auto idx = 0uz;
-  auto csv_idx = 0;
+  auto reader = row_reader<std::vector<float>>{
+      .indices = indices, .timebase = timebase, .result = result};
   read_csv_impl(
-      f, delim,
-      [&](const char *s, const char *e)
-      {
-        ++csv_idx; // this is 1-based
-        if (idx < indices.size() && csv_idx == indices[idx])
-        {
-          result.push_back(parse_field(s, e, timebase));
-          ++idx;
-        }
-      },
-      [&]
-      {
-        for (; idx < indices.size(); ++idx)
-        {
-          result.push_back(0.0f);
-        }
-        idx = 0uz;
-        csv_idx = 0;
-      });
+      f, delim, [&](const char *s, const char *e) { reader.field(s, e); },
+      [&] { reader.end_of_line(); });
 
   return result;
 }
 
+std::size_t read_csv(const std::filesystem::path &p, char delim, std::span<const int> indices,
+                     shared_timebase &timebase, std::span<float> chunk,
+                     const csv_chunk_sink &next_chunk)
+{
+  auto f = std::ifstream(p, std::ios::binary);
+
+  // the shared timebase is only locked until the first date of this file is read
+  auto local_timebase = std::optional<time_point>();
+  auto writer = chunk_writer{.next_chunk = next_chunk, .chunk = chunk};
+  auto reader = row_reader<chunk_writer>{
+      .indices = indices, .timebase = local_timebase, .result = writer, .shared = &timebase};
+  read_csv_impl(
+      f, delim, [&](const char *s, const char *e) { reader.field(s, e); },
+      [&] { reader.end_of_line(); });
+  return writer.size;
+}
+
+std::uint32_t estimate_lines(const std::filesystem::path &p)
+{
+  static constexpr auto sample_size = 1z << 16;
+  auto f = std::ifstream(p, std::ios::binary);
+  if (!f.is_open())
+  {
+    return 0u;
+  }
+  auto buffer = std::make_unique_for_overwrite<char[]>(sample_size);
+  f.read(buffer.get(), sample_size);
+  const auto read = f.gcount();
+  const auto lines = std::count(buffer.get(), buffer.get() + read, '\n');
+  if (read < sample_size || lines == 0)
+  {
+    return static_cast<std::uint32_t>(lines + 1);
+  }
+  const auto bytes_per_line = static_cast<double>(read) / static_cast<double>(lines);
+  return static_cast<std::uint32_t>(static_cast<double>(std::filesystem::file_size(p))
+                                    / bytes_per_line)
+         + 1u;
+}
+
+void read_csv_line(std::string_view line, char delim, std::span<const int> indices,
+                   std::optional<time_point> &timebase, std::vector<float> &result)
+{
+  auto reader = row_reader<std::vector<float>>{
+      .indices = indices, .timebase = timebase, .result = result};
+  auto start_of_field = line.data();
+  const auto end = line.data() + line.size();
+  for (auto c = start_of_field; c != end; ++c)
+  {
+    if (*c == delim)
+    {
+      reader.field(start_of_field, c);
+      start_of_field = c + 1;
+    }
+  }
+  if (!std::all_of(start_of_field, end, [](char c) { return std::isspace(c); }))
+  {
+    reader.field(start_of_field, end);
+  }
+  reader.end_of_line();
+}
+
 std::uint32_t count_lines(const std::filesystem::path &p)
 {
   auto result = 0u;
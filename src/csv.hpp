@@ -4,15 +4,51 @@
 #include <span>
 #include <optional>
 #include <chrono>
+#include <string_view>
+#include <functional>
+#include <mutex>
 
 namespace explot
 {
 using time_point = std::chrono::time_point<std::chrono::system_clock, std::chrono::microseconds>;
+
+// Dates are read as seconds since the first date that was read. The first date is shared by all
+// files of a plot, which may be parsed on several threads.
+class shared_timebase
+{
+public:
+  // returns the timebase, which is set to tp if no date was read before
+  time_point get_or_set(time_point tp);
+  std::optional<time_point> get();
+
+private:
+  std::mutex mutex;
+  std::optional<time_point> value;
+};
+
 std::vector<float> read_csv(const std::filesystem::path &p, char delim, std::span<int> indices,
                             std::optional<time_point> &timebase);
 
+// Receives a full chunk and returns the next one. The size of chunks must be a multiple of
+// indices.size().
+using csv_chunk_sink = std::function<std::span<float>(std::span<float> full)>;
+
+// Like read_csv, but writes the rows to chunk and the chunks returned by next_chunk instead of a
+// vector. Returns the number of values in the last chunk.
+std::size_t read_csv(const std::filesystem::path &p, char delim, std::span<const int> indices,
+                     shared_timebase &timebase, std::span<float> chunk,
+                     const csv_chunk_sink &next_chunk);
+
+// parses a single record without the trailing newline and appends the fields selected by indices
+// to result.
+void read_csv_line(std::string_view line, char delim, std::span<const int> indices,
+                   std::optional<time_point> &timebase, std::vector<float> &result);
+
 std::uint32_t count_lines(const std::filesystem::path &p);
 
+// Extrapolates the number of lines from the beginning of the file.
+std::uint32_t estimate_lines(const std::filesystem::path &p);
+
 std::pair<std::vector<float>, unsigned int>
 read_matrix_csv(const std::filesystem::path &p, char delim, std::optional<time_point> &timebase);
 } // namespace explot
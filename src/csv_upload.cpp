@@ -0,0 +1,317 @@
+#include "csv_upload.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <variant>
+
+namespace
+{
+using namespace explot;
+
+constexpr auto min_chunk_rows = 1u << 16;
+
+struct mapped_chunk
+{
+  vbo_handle vbo;
+  std::span<float> data;
+  // If the buffer could not be mapped, the rows are parsed into staging and uploaded by flush.
+  std::vector<float> staging;
+  bool mapped;
+};
+
+mapped_chunk make_mapped_chunk(std::size_t size)
+{
+  auto vbo = make_vbo();
+  const auto bytes = static_cast<GLsizeiptr>(size * sizeof(float));
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+  auto ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes,
+                              GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+  if (ptr != nullptr)
+  {
+    return mapped_chunk{std::move(vbo), std::span(static_cast<float *>(ptr), size), {}, true};
+  }
+  // the storage of the buffer is immutable, so a mutable one is created for the upload
+  vbo = make_vbo();
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+  auto staging = std::vector<float>(size);
+  const auto data = std::span(staging);
+  return mapped_chunk{std::move(vbo), data, std::move(staging), false};
+}
+
+void flush(const mapped_chunk &chunk, std::size_t size)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+  const auto bytes = static_cast<GLsizeiptr>(size * sizeof(float));
+  if (chunk.mapped)
+  {
+    glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, bytes);
+  }
+  else
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, chunk.staging.data());
+  }
+}
+
+// one per file, shared by its parser and the thread with the GL context. chunks, num_flushed and
+// finished are only used by the thread with the GL context, the rest is guarded by the mutex of
+// upload_exchange.
+struct file_upload
+{
+  std::vector<mapped_chunk> chunks;
+  std::span<float> first;
+  std::size_t next_size;
+  std::optional<std::span<float>> next;
+  bool requested = false;
+  std::size_t num_full = 0uz;
+  std::size_t num_flushed = 0uz;
+  std::optional<std::size_t> last_size;
+  bool finished = false;
+};
+
+// what the thread with the GL context has to do for a file_upload, taken under the lock
+struct upload_work
+{
+  std::size_t num_full;
+  bool requested;
+  std::optional<std::size_t> last_size;
+};
+
+struct upload_exchange
+{
+  std::mutex mutex;
+  std::condition_variable gl;
+  std::condition_variable parsers;
+  bool changed = false;
+  std::vector<file_upload> uploads;
+};
+
+file_upload start_upload(const csv_file &file)
+{
+  const auto row_size = file.indices.size();
+  assert(row_size > 0);
+  const auto estimate = estimate_lines(file.path);
+  // the estimate is extrapolated, so it gets some slack
+  const auto first_rows = estimate + estimate / 16 + 1u;
+  const auto next_rows = std::max(min_chunk_rows, first_rows / 4);
+
+  auto result = file_upload{};
+  result.chunks.push_back(make_mapped_chunk(first_rows * row_size));
+  result.first = result.chunks.front().data;
+  result.next_size = next_rows * row_size;
+  return result;
+}
+
+void parse(upload_exchange &exchange, std::size_t i, const csv_file &file, char delim,
+           shared_timebase &timebase)
+{
+  auto &upload = exchange.uploads[i];
+  auto last_size = read_csv(file.path, delim, file.indices, timebase, upload.first,
+                            [&](std::span<float>)
+                            {
+                              auto lock = std::unique_lock(exchange.mutex);
+                              ++upload.num_full;
+                              upload.requested = true;
+                              exchange.changed = true;
+                              exchange.gl.notify_one();
+                              exchange.parsers.wait(lock,
+                                                    [&] { return upload.next.has_value(); });
+                              return *std::exchange(upload.next, std::nullopt);
+                            });
+  auto lock = std::scoped_lock(exchange.mutex);
+  upload.last_size = last_size;
+  exchange.changed = true;
+  exchange.gl.notify_one();
+}
+
+constexpr auto evaluation_chunk_rows = 1u << 14;
+
+// The rows are parsed into a chunk that fits into the cache and evaluated whenever it is full.
+evaluated_rows evaluate_file(const csv_evaluation &file, char delim, shared_timebase &timebase)
+{
+  const auto row_size = file.indices.size();
+  assert(row_size > 0);
+  auto rows = std::vector<float>(evaluation_chunk_rows * row_size);
+  const auto estimate = estimate_lines(file.path);
+  auto result = evaluated_rows{std::vector<std::vector<float>>(file.programs.size()), 0u};
+  auto inputs = std::vector<std::vector<vm_column>>();
+  for (auto p = 0uz; p < file.programs.size(); ++p)
+  {
+    const auto &program = file.programs[p];
+    result.values[p].reserve((estimate + estimate / 16 + 1u) * program.outputs.size());
+    auto &columns = inputs.emplace_back();
+    for (const auto &in : program.inputs)
+    {
+      const auto column = std::ranges::find(file.indices, std::get<data_ref>(in).idx);
+      assert(column != file.indices.end());
+      const auto offset = static_cast<std::size_t>(column - file.indices.begin());
+      columns.push_back(vm_column{rows.data() + offset, row_size});
+    }
+  }
+
+  auto evaluate_rows = [&](std::size_t size)
+  {
+    const auto n = static_cast<uint32_t>(size / row_size);
+    for (auto p = 0uz; p < file.programs.size(); ++p)
+    {
+      auto &values = result.values[p];
+      const auto first = values.size();
+      values.resize(first + n * file.programs[p].outputs.size());
+      evaluate(file.programs[p], inputs[p], result.num_rows, n, std::span(values).subspan(first));
+    }
+    result.num_rows += n;
+  };
+  const auto last_size = read_csv(file.path, delim, file.indices, timebase, rows,
+                                  [&](std::span<float> full)
+                                  {
+                                    evaluate_rows(full.size());
+                                    return full;
+                                  });
+  evaluate_rows(last_size);
+  return result;
+}
+} // namespace
+
+namespace explot
+{
+std::vector<std::vector<row_chunk>> upload_csv(std::span<const csv_file> files, char delim,
+                                               shared_timebase &timebase)
+{
+  auto exchange = upload_exchange();
+  exchange.uploads.reserve(files.size());
+  for (const auto &f : files)
+  {
+    exchange.uploads.push_back(start_upload(f));
+  }
+
+  auto next_file = std::atomic<std::size_t>(0uz);
+  const auto num_workers =
+      std::min(files.size(), std::max(1uz, std::size_t{std::thread::hardware_concurrency()}));
+  auto workers = std::vector<std::jthread>();
+  workers.reserve(num_workers);
+  for (auto w = 0uz; w < num_workers; ++w)
+  {
+    workers.emplace_back(
+        [&]
+        {
+          for (auto i = next_file++; i < files.size(); i = next_file++)
+          {
+            parse(exchange, i, files[i], delim, timebase);
+          }
+        });
+  }
+
+  // the GL calls are made without the lock, so that the parsers are not blocked by them
+  auto num_finished = 0uz;
+  auto work = std::vector<upload_work>(files.size());
+  while (num_finished < files.size())
+  {
+    {
+      auto lock = std::unique_lock(exchange.mutex);
+      exchange.gl.wait(lock, [&] { return exchange.changed; });
+      exchange.changed = false;
+      for (auto f = 0uz; f < files.size(); ++f)
+      {
+        auto &upload = exchange.uploads[f];
+        work[f] = upload_work{upload.num_full, std::exchange(upload.requested, false),
+                              upload.last_size};
+      }
+    }
+    auto requested = false;
+    for (auto f = 0uz; f < files.size(); ++f)
+    {
+      auto &upload = exchange.uploads[f];
+      // full chunks are handed to the GPU while the parsers continue
+      for (; upload.num_flushed < work[f].num_full; ++upload.num_flushed)
+      {
+        const auto &chunk = upload.chunks[upload.num_flushed];
+        flush(chunk, chunk.data.size());
+      }
+      if (work[f].requested)
+      {
+        upload.chunks.push_back(make_mapped_chunk(upload.next_size));
+        requested = true;
+      }
+      else if (work[f].last_size && !upload.finished)
+      {
+        flush(upload.chunks.back(), *work[f].last_size);
+        upload.finished = true;
+        ++num_finished;
+      }
+    }
+    if (requested)
+    {
+      auto lock = std::scoped_lock(exchange.mutex);
+      for (auto f = 0uz; f < files.size(); ++f)
+      {
+        if (work[f].requested)
+        {
+          exchange.uploads[f].next = exchange.uploads[f].chunks.back().data;
+        }
+      }
+      exchange.parsers.notify_all();
+    }
+  }
+  workers.clear();
+
+  auto result = std::vector<std::vector<row_chunk>>();
+  result.reserve(files.size());
+  for (auto f = 0uz; f < files.size(); ++f)
+  {
+    const auto row_size = files[f].indices.size();
+    auto &chunks = exchange.uploads[f].chunks;
+    auto &file_result = result.emplace_back();
+    file_result.reserve(chunks.size());
+    for (auto i = 0uz; i < chunks.size(); ++i)
+    {
+      if (chunks[i].mapped)
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, chunks[i].vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+      }
+      const auto size =
+          i + 1 < chunks.size() ? chunks[i].data.size() : *exchange.uploads[f].last_size;
+      if (size > 0)
+      {
+        file_result.emplace_back(std::move(chunks[i].vbo), static_cast<uint32_t>(size / row_size));
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<row_chunk> upload_csv(const std::filesystem::path &p, char delim,
+                                  std::span<const int> indices, shared_timebase &timebase)
+{
+  const csv_file files[] = {{p, indices}};
+  return std::move(upload_csv(files, delim, timebase).front());
+}
+
+std::vector<evaluated_rows> evaluate_csv(std::span<const csv_evaluation> files, char delim,
+                                         shared_timebase &timebase)
+{
+  auto result = std::vector<evaluated_rows>(files.size());
+  auto next_file = std::atomic<std::size_t>(0uz);
+  const auto num_workers =
+      std::min(files.size(), std::max(1uz, std::size_t{std::thread::hardware_concurrency()}));
+  auto workers = std::vector<std::jthread>();
+  workers.reserve(num_workers);
+  for (auto w = 0uz; w < num_workers; ++w)
+  {
+    workers.emplace_back(
+        [&]
+        {
+          for (auto i = next_file++; i < files.size(); i = next_file++)
+          {
+            result[i] = evaluate_file(files[i], delim, timebase);
+          }
+        });
+  }
+  workers.clear();
+  return result;
+}
+} // namespace explot
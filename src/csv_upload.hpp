@@ -0,0 +1,56 @@
+#pragma once
+
+#include "gl-handle.hpp"
+#include "csv.hpp"
+#include "expr_vm.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace explot
+{
+struct row_chunk
+{
+  vbo_handle vbo;
+  uint32_t num_rows;
+};
+
+struct csv_file
+{
+  std::filesystem::path path;
+  std::span<const int> indices;
+};
+
+// Parses the columns in indices of every file directly into persistently mapped buffers. Files are
+// parsed concurrently on a pool of worker threads. The first buffer of a file is sized from an
+// estimate of the number of rows, further buffers are added as needed. Buffers are allocated and
+// flushed on the calling thread, which needs the GL context. indices must not be empty.
+std::vector<std::vector<row_chunk>> upload_csv(std::span<const csv_file> files, char delim,
+                                               shared_timebase &timebase);
+
+std::vector<row_chunk> upload_csv(const std::filesystem::path &p, char delim,
+                                  std::span<const int> indices, shared_timebase &timebase);
+
+// a file whose rows are evaluated by programs while they are parsed. The inputs of the programs
+// must be columns in indices.
+struct csv_evaluation
+{
+  std::filesystem::path path;
+  std::span<const int> indices;
+  std::span<const vm_program> programs;
+};
+
+struct evaluated_rows
+{
+  // the outputs of every program, row by row
+  std::vector<std::vector<float>> values;
+  uint32_t num_rows;
+};
+
+// Like upload_csv, but the parsed rows never leave the worker threads. Only the outputs of the
+// programs are kept, so that the columns do not need to be uploaded for a pass on the GPU.
+std::vector<evaluated_rows> evaluate_csv(std::span<const csv_evaluation> files, char delim,
+                                         shared_timebase &timebase);
+} // namespace explot
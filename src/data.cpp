@@ -15,10 +15,22 @@
 #include "program.hpp"
 #include <unordered_map>
 #include <utility>
-#include <algorithm>
 #include <map>
 #include <vector>
 #include "user_definitions.hpp"
+#include "expr_dag.hpp"
+#include "csv_upload.hpp"
+#include "gpu_csv.hpp"
+#include "minmax.hpp"
+#include "prefix_sum.hpp"
+#include "expr_vm.hpp"
+#include "points_cache.hpp"
+#include "settings.hpp"
+#include <filesystem>
+#include <cmath>
+#include <bit>
+#include <future>
+#include <limits>
 
 using namespace std::literals;
 
@@ -26,145 +38,197 @@ namespace
 {
 using namespace explot;
 
-std::string to_glsl(const expr &e, std::span<const int> indices = {})
+struct glsl_code
 {
-  namespace views = std::ranges::views;
-  struct visitor
-  {
-    std::span<const int> indices;
-    std::string operator()(const literal_expr &l) const { return std::to_string(l.value); }
-
-    std::string operator()(const var &v) const { return v.name; }
-
-    std::string operator()(const box<unary_builtin_call> &call) const
-    {
-      return fmt::format("{}({})", call->name, std::visit(*this, call->arg));
-    }
-
-    std::string operator()(const box<binary_builtin_call> &call) const
-    {
-      return fmt::format("{}({}, {})", call->name, std::visit(*this, call->arg1),
-                         std::visit(*this, call->arg2));
-    }
+  // declarations of the subexpressions that are used more than once
+  std::string locals;
+  std::vector<std::string> values;
+};
 
-    std::string operator()(data_ref d) const
+// Common subexpressions of exprs are declared once as locals, named with prefix and the node.
+// Column 0 is replaced by row_number.
+glsl_code to_glsl(std::span<const expr> exprs, std::span<const int> indices = {},
+                  std::string_view prefix = "_c",
+                  std::string_view row_number = "(float(gl_VertexID) + row_offset)")
+{
+  const auto dag = make_dag(exprs, user_inlining::calls);
+  auto result = glsl_code();
+  auto text = std::vector<std::string>();
+  text.reserve(dag.nodes.size());
+  for (auto i = 0uz; i < dag.nodes.size(); ++i)
+  {
+    const auto &n = dag.nodes[i];
+    auto t = [&]() -> std::string
     {
-      if (d.idx == 0)
+      auto arg = [&](std::size_t a) -> const std::string & { return text[n.args[a]]; };
+      switch (n.op)
       {
-        return "gl_VertexID";
+      case dag_op::literal:
+      {
+        const auto value = static_cast<float>(n.value);
+        // GLSL has no literals for NaN and infinity
+        if (!std::isfinite(value))
+        {
+          return fmt::format("uintBitsToFloat({}u)", std::bit_cast<uint32_t>(value));
+        }
+        else
+        {
+          // 9 significant digits give the same float back, a . or e makes it a float literal
+          auto literal = fmt::format("{:.9g}", value);
+          if (literal.find_first_of(".e") == std::string::npos)
+          {
+            literal += ".0";
+          }
+          return literal;
+        }
       }
-      const auto idx = std::ranges::find(indices, d.idx);
-      const auto pos = std::distance(indices.begin(), idx);
-      assert(idx != indices.end());
-      return fmt::format("row[{}]", pos);
-    }
-
-    std::string operator()(const box<unary_op> &op) const
-    {
-      auto o = op->op == unary_operator::minus ? '-' : '+';
-      return fmt::format("{}({})", o, std::visit(*this, op->operand));
-    }
-
-    std::string operator()(const box<binary_op> &op) const
-    {
-      auto o = [&]
+      case dag_op::variable:
+        return n.name;
+      case dag_op::column:
       {
-        switch (op->op)
+        if (n.idx == 0)
         {
-        case binary_operator::plus:
-          return '+';
-        case binary_operator::minus:
-          return '-';
-        case binary_operator::mult:
-          return '*';
-        case binary_operator::div:
-          return '/';
+          return std::string(row_number);
         }
-      }();
-      return fmt::format("({}) {} ({})", std::visit(*this, op->lhs), o, std::visit(*this, op->rhs));
+        const auto idx = std::ranges::find(indices, static_cast<int>(n.idx));
+        assert(idx != indices.end());
+        return fmt::format("row[{}]", std::distance(indices.begin(), idx));
+      }
+      case dag_op::user_variable:
+        return get_definition(n.idx).name;
+      case dag_op::neg:
+        return fmt::format("-({})", arg(0));
+      case dag_op::add:
+        return fmt::format("({}) + ({})", arg(0), arg(1));
+      case dag_op::sub:
+        return fmt::format("({}) - ({})", arg(0), arg(1));
+      case dag_op::mul:
+        return fmt::format("({}) * ({})", arg(0), arg(1));
+      case dag_op::div:
+        return fmt::format("({}) / ({})", arg(0), arg(1));
+      case dag_op::less:
+        return fmt::format("float(({}) < ({}))", arg(0), arg(1));
+      case dag_op::less_equal:
+        return fmt::format("float(({}) <= ({}))", arg(0), arg(1));
+      case dag_op::greater:
+        return fmt::format("float(({}) > ({}))", arg(0), arg(1));
+      case dag_op::greater_equal:
+        return fmt::format("float(({}) >= ({}))", arg(0), arg(1));
+      case dag_op::equal:
+        return fmt::format("float(({}) == ({}))", arg(0), arg(1));
+      case dag_op::not_equal:
+        return fmt::format("float(({}) != ({}))", arg(0), arg(1));
+      case dag_op::logical_and:
+        return fmt::format("float(({}) != 0.0 && ({}) != 0.0)", arg(0), arg(1));
+      case dag_op::logical_or:
+        return fmt::format("float(({}) != 0.0 || ({}) != 0.0)", arg(0), arg(1));
+      case dag_op::logical_not:
+        return fmt::format("float(({}) == 0.0)", arg(0));
+      case dag_op::select:
+        return fmt::format("(({}) != 0.0 ? ({}) : ({}))", arg(0), arg(1), arg(2));
+      case dag_op::unary_call:
+        return fmt::format("{}({})", n.name, arg(0));
+      case dag_op::binary_call:
+        return fmt::format("{}({}, {})", n.name, arg(0), arg(1));
+      case dag_op::user_call:
+        return fmt::format("{}({})", get_definition(n.idx).name,
+                           fmt::join(n.args
+                                         | std::views::transform([&](uint32_t a) -> const auto &
+                                                                 { return text[a]; }),
+                                     ", "));
+      }
+    }();
+    if (!is_leaf(n) && n.uses > 1)
+    {
+      fmt::format_to(std::back_inserter(result.locals), "float {}{} = {};\n", prefix, i, t);
+      t = fmt::format("{}{}", prefix, i);
     }
+    text.push_back(std::move(t));
+  }
+  for (auto root : dag.roots)
+  {
+    result.values.push_back(text[root]);
+  }
+  return result;
+}
 
-    std::string operator()(const user_var_ref &ref) const { return get_definition(ref.idx).name; }
-
-    std::string operator()(const box<user_function_call> &call) const
+// Adds the user functions called in the DAG of exprs and in their bodies, each after the functions
+// it calls. Inlined functions are not called anymore.
+void called_functions(std::span<const expr> exprs, std::vector<uint32_t> &functions,
+                      std::vector<uint32_t> &visited)
+{
+  const auto dag = make_dag(exprs, user_inlining::calls);
+  for (const auto &n : dag.nodes)
+  {
+    if (n.op != dag_op::user_call || std::ranges::find(visited, n.idx) != visited.end())
     {
-      return fmt::format("{}({})", get_definition(call->idx).name,
-                         fmt::join(call->args
-                                       | std::views::transform([this](const expr &arg)
-                                                               { return std::visit(*this, arg); }),
-                                   ", "));
+      continue;
     }
-  };
-  return std::visit(visitor{indices}, e);
+    visited.push_back(n.idx);
+    const auto def = get_definition(n.idx);
+    called_functions({&def.body, 1}, functions, visited);
+    functions.push_back(n.idx);
+  }
 }
 
-std::string glsl_definitions(std::span<const uint32_t> defs)
+std::vector<uint32_t> called_functions(std::span<const expr> exprs)
 {
-  std::string result;
+  auto functions = std::vector<uint32_t>();
+  auto visited = std::vector<uint32_t>();
+  called_functions(exprs, functions, visited);
+  return functions;
+}
 
-  for (auto idx : defs)
+std::string glsl_functions(std::span<const uint32_t> functions)
+{
+  std::string result;
+  for (auto idx : functions)
   {
     const auto &def = get_definition(idx);
-    if (def.params)
-    {
-      fmt::format_to(std::back_inserter(result), "float {}({}) {{ return {}; }}", def.name,
-                     fmt::join(def.params.value()
-                                   | std::views::transform([](const std::string &p)
-                                                           { return fmt::format("float {}", p); }),
-                               ", "),
-                     to_glsl(def.body));
-    }
-    else
-    {
-      fmt::format_to(std::back_inserter(result), "float {} = {};", def.name, to_glsl(def.body));
-    }
+    const auto body = to_glsl({&def.body, 1});
+    fmt::format_to(std::back_inserter(result), "float {}({}) {{ {}return {}; }}\n", def.name,
+                   fmt::join(def.params.value()
+                                 | std::views::transform([](const std::string &p)
+                                                         { return fmt::format("float {}", p); }),
+                             ", "),
+                   body.locals, body.values[0]);
   }
   return result;
 }
 
-void extract_user_refs(const expr &e, std::vector<uint32_t> &refs)
+std::vector<uint32_t> constant_variables(std::span<const expr> exprs)
 {
-  struct visitor
+  auto variables = std::vector<uint32_t>();
+  for (const auto &e : exprs)
   {
-    std::vector<uint32_t> &refs;
-
-    void operator()(const literal_expr &) {}
-    void operator()(const box<unary_op> &op) { std::visit(*this, op->operand); }
-    void operator()(const box<binary_op> &op)
-    {
-      std::visit(*this, op->lhs);
-      std::visit(*this, op->rhs);
-    }
-    void operator()(const box<unary_builtin_call> &call) { std::visit(*this, call->arg); }
-    void operator()(const box<binary_builtin_call> &call)
-    {
-      std::visit(*this, call->arg1);
-      std::visit(*this, call->arg2);
-    }
-    void operator()(const box<user_function_call> &call) { refs.push_back(call->idx); }
-    void operator()(const user_var_ref &ref) { refs.push_back(ref.idx); }
-    void operator()(const var &) {}
-    void operator()(const data_ref) {}
-  };
-
-  std::visit(visitor{refs}, e);
+    used_variables(e, variables);
+  }
+  std::ranges::sort(variables);
+  variables.erase(std::ranges::unique(variables).begin(), variables.end());
+  std::erase_if(variables, [](uint32_t idx) { return !constant_value(idx).has_value(); });
+  return variables;
 }
 
-std::vector<uint32_t> extract_user_refs(std::span<const expr> exprs)
+// Constant variables are uniforms, so that the program does not change with their values. They
+// are set by with_user_variables. Other variables use inputs and are inlined by to_glsl.
+std::string glsl_definitions(std::span<const expr> exprs)
 {
-  std::vector<uint32_t> result;
-  for (const auto &e : exprs)
+  auto result = std::string();
+  for (auto idx : constant_variables(exprs))
   {
-    extract_user_refs(e, result);
+    fmt::format_to(std::back_inserter(result), "uniform float {};\n", get_definition(idx).name);
   }
-  std::ranges::sort(result);
-  result.erase(std::ranges::unique(result).begin(), result.end());
-  return result;
+  return result + glsl_functions(called_functions(exprs));
 }
 
-std::string glsl_definitions(std::span<const expr> exprs)
+program_handle with_user_variables(program_handle program, std::span<const expr> exprs)
 {
-  return glsl_definitions(extract_user_refs(exprs));
+  for (auto idx : constant_variables(exprs))
+  {
+    glProgramUniform1f(program, glGetUniformLocation(program, get_definition(idx).name.c_str()),
+                       *constant_value(idx));
+  }
+  return program;
 }
 
 program_handle program_for_expressions(const char *shader_source_fmt, std::span<const expr> exprs,
@@ -178,11 +242,12 @@ program_handle program_for_expressions(const char *shader_source_fmt, std::span<
   auto varyings_ptrs = std::vector<const char *>();
   varyings_ptrs.reserve(exprs.size());
 
+  const auto code = to_glsl(exprs, indices);
+  assignments_str += code.locals;
   for (auto i = 0u; i < exprs.size(); ++i)
   {
     fmt::format_to(std::back_inserter(varyings_str), "out float v{};\n", i);
-    fmt::format_to(std::back_inserter(assignments_str), "v{} = {};\n", i,
-                   to_glsl(exprs[i], indices));
+    fmt::format_to(std::back_inserter(assignments_str), "v{} = {};\n", i, code.values[i]);
 
     varyings_ids.push_back(fmt::format("v{}", i));
     varyings_ptrs.push_back(varyings_ids.back().c_str());
@@ -191,8 +256,7 @@ program_handle program_for_expressions(const char *shader_source_fmt, std::span<
   auto prelude = varyings_str + glsl_definitions(exprs);
 
   auto shader_src = fmt::format(fmt::runtime(shader_source_fmt), prelude, assignments_str);
-  // fmt::println("{}", shader_src);
-  return make_program_with_varying(shader_src.c_str(), varyings_ptrs);
+  return with_user_variables(make_program_with_varying(shader_src.c_str(), varyings_ptrs), exprs);
 }
 
 program_handle program_for_using_expressions(std::span<const expr> exprs,
@@ -200,6 +264,7 @@ program_handle program_for_using_expressions(std::span<const expr> exprs,
 {
   static constexpr char shader_source_fmt[] = R"(#version 330 core
 layout(location = 0) in float row[{}];
+uniform float row_offset;
 
 {{}}
 
@@ -224,7 +289,7 @@ uniform float step_x;
 
 void  main()
 {{
-  float x = min_x + step_x * gl_InstanceID;
+  float x = min_x + step_x * gl_VertexID;
   {}
 }}
 )";
@@ -245,17 +310,18 @@ out vec2 v;
 
 void  main()
 {{
-  float t = min_t + step_t * gl_InstanceID;
+  float t = min_t + step_t * gl_VertexID;
+  {}
   float x_value = {};
   float y_value = {};
   v = vec2(x_value, y_value);
 }}
 )";
-  auto x_glsl = to_glsl(exprs[0]);
-  auto y_glsl = to_glsl(exprs[1]);
+  auto code = to_glsl(exprs);
   auto glsl_defs = glsl_definitions(exprs);
-  auto shader_source = fmt::format(shader_source_fmt, glsl_defs, x_glsl, y_glsl);
-  return make_program_with_varying(shader_source.c_str(), "v");
+  auto shader_source =
+      fmt::format(shader_source_fmt, glsl_defs, code.locals, code.values[0], code.values[1]);
+  return with_user_variables(make_program_with_varying(shader_source.c_str(), "v"), exprs);
 }
 
 program_handle program_for_functional_data_3d_y(const expr &e)
@@ -276,13 +342,15 @@ void  main()
 {{
   float x = min_x + floor(gl_VertexID / num_points_per_line) * step_x;
   float y = min_y + (gl_VertexID % num_points_per_line) * step_y;
+  {}
   float value = {};
   v = vec3(x, y, value);
 }}
 )shader";
-  auto glsl = to_glsl(e);
-  const auto shader_source = fmt::format(shader_source_fmt, glsl_definitions({&e, 1}), glsl);
-  return make_program_with_varying(shader_source.c_str(), "v");
+  const auto code = to_glsl({&e, 1});
+  const auto shader_source = fmt::format(shader_source_fmt, glsl_definitions({&e, 1}),
+                                         code.locals, code.values[0]);
+  return with_user_variables(make_program_with_varying(shader_source.c_str(), "v"), {&e, 1});
 }
 
 program_handle program_for_functional_data_3d_x(const expr &e)
@@ -303,13 +371,15 @@ void  main()
 {{
   float x = min_x + (gl_VertexID % num_points_per_line) * step_x;
   float y = min_y + floor(gl_VertexID / num_points_per_line) * step_y;
+  {}
   float value = {};
   v = vec3(x, y, value);
 }}
 )shader";
-  const auto glsl = to_glsl(e);
-  const auto shader_source = fmt::format(shader_source_fmt, glsl_definitions({&e, 1}), glsl);
-  return make_program_with_varying(shader_source.c_str(), "v");
+  const auto code = to_glsl({&e, 1});
+  const auto shader_source = fmt::format(shader_source_fmt, glsl_definitions({&e, 1}),
+                                         code.locals, code.values[0]);
+  return with_user_variables(make_program_with_varying(shader_source.c_str(), "v"), {&e, 1});
 }
 
 program_handle program_for_parametric_data_3d_v(const expr (&exprs)[3])
@@ -330,18 +400,18 @@ void  main()
 {{
   float u = min_u + floor(gl_VertexID / num_points_per_line) * step_u;
   float v = min_v + (gl_VertexID % num_points_per_line) * step_v;
+  {}
   float x = {};
   float y = {};
   float z = {};
   p = vec3(x, y, z);
 }}
 )shader";
-  const auto x_glsl = to_glsl(exprs[0]);
-  const auto y_glsl = to_glsl(exprs[1]);
-  const auto z_glsl = to_glsl(exprs[2]);
+  const auto code = to_glsl(exprs);
   const auto glsl_defs = glsl_definitions(exprs);
-  const auto shader_source = fmt::format(shader_source_fmt, glsl_defs, x_glsl, y_glsl, z_glsl);
-  return make_program_with_varying(shader_source.c_str(), "p");
+  const auto shader_source = fmt::format(shader_source_fmt, glsl_defs, code.locals,
+                                         code.values[0], code.values[1], code.values[2]);
+  return with_user_variables(make_program_with_varying(shader_source.c_str(), "p"), exprs);
 }
 
 program_handle program_for_parametric_data_3d_u(const expr (&exprs)[3])
@@ -362,50 +432,29 @@ void  main()
 {{
   float u = min_u + (gl_VertexID % num_points_per_line) * step_u;
   float v = min_v + floor(gl_VertexID / num_points_per_line) * step_v;
+  {}
   float x = {};
   float y = {};
   float z = {};
   p = vec3(x, y, z);
 }}
 )shader";
-  const auto x_glsl = to_glsl(exprs[0]);
-  const auto y_glsl = to_glsl(exprs[1]);
-  const auto z_glsl = to_glsl(exprs[2]);
+  const auto code = to_glsl(exprs);
   const auto glsl_defs = glsl_definitions(exprs);
-  const auto shader_source = fmt::format(shader_source_fmt, glsl_defs, x_glsl, y_glsl, z_glsl);
-  return make_program_with_varying(shader_source.c_str(), "p");
+  const auto shader_source = fmt::format(shader_source_fmt, glsl_defs, code.locals,
+                                         code.values[0], code.values[1], code.values[2]);
+  return with_user_variables(make_program_with_varying(shader_source.c_str(), "p"), exprs);
 }
 
 void extract_indices(const expr &e, std::vector<int> &indices)
 {
-  struct visitor
+  for (const auto &n : e.nodes)
   {
-    std::vector<int> *indices;
-    void operator()(const literal_expr &) {}
-    void operator()(const var &) {}
-    void operator()(const box<unary_builtin_call> &call) { std::visit(*this, call->arg); }
-    void operator()(const box<binary_builtin_call> &call)
-    {
-      std::visit(*this, call->arg1);
-      std::visit(*this, call->arg2);
-    }
-    void operator()(const box<unary_op> &u) { std::visit(*this, u->operand); }
-    void operator()(const box<binary_op> &b)
-    {
-      std::visit(*this, b->lhs);
-      std::visit(*this, b->rhs);
-    }
-    void operator()(const data_ref &d) { indices->push_back(d.idx); }
-    void operator()(const user_var_ref &) {}
-    void operator()(const box<user_function_call> &call)
+    if (n.op == expr_op::column)
     {
-      for (const auto &arg : call->args)
-      {
-        std::visit(*this, arg);
-      }
+      indices.push_back(static_cast<int>(n.idx));
     }
-  };
-  std::visit(visitor{&indices}, e);
+  }
 }
 
 std::vector<int> extract_indices(std::span<const expr> expressions)
@@ -450,200 +499,1384 @@ std::vector<int> grid_indices_for_lines(uint32_t num_points, uint32_t num_column
   return result;
 }
 
+struct evaluated_points
+{
+  vbo_handle vbo;
+  // (min, max) of every component of the points
+  std::vector<glm::vec2> bounds;
+};
+
 struct row_data
 {
   std::string filename;
   std::optional<uint32_t> columns;
   std::vector<int> indices;
   uint32_t num_points;
-  vbo_handle vbo;
+  std::vector<row_chunk> chunks;
+  // the points of the graphs whose using expressions were evaluated while the file was parsed
+  std::vector<std::pair<const csv_data *, evaluated_points>> evaluated;
 };
 
-std::pair<std::vector<row_data>, time_point>
-row_data_for_graphs(const std::span<const graph_desc_2d> gs, char separator)
+// reads the rows of all files at once, so that the CPU engine can parse them concurrently. The
+// GPU engine is already parallel within a file and reads them one after another.
+std::vector<std::vector<row_chunk>> read_rows(std::span<const csv_file> files, char separator,
+                                              datafile_engine engine, shared_timebase &timebase)
 {
-  auto files = std::unordered_map<std::string_view, std::vector<int>>();
-  for (const auto &g : gs)
+  auto result = std::vector<std::vector<row_chunk>>(files.size());
+  auto to_upload = std::vector<csv_file>();
+  auto upload_idx = std::vector<std::size_t>();
+  for (auto i = 0uz; i < files.size(); ++i)
   {
-    if (g.data.index() != 1)
+    if (files[i].indices.empty())
     {
       continue;
     }
+    else if (engine == datafile_engine::gpu)
+    {
+      result[i] = parse_csv_on_gpu(files[i].path, separator, files[i].indices, timebase);
+    }
     else
     {
-      const auto &d = std::get<1>(g.data);
-      auto &indices = files[d.path];
-      auto new_indices = extract_indices(d.expressions);
-      indices.reserve(indices.size() + new_indices.size());
-      std::ranges::copy(new_indices, std::back_inserter(indices));
+      to_upload.push_back(files[i]);
+      upload_idx.push_back(i);
+    }
+  }
+  auto uploaded = upload_csv(to_upload, separator, timebase);
+  for (auto i = 0uz; i < uploaded.size(); ++i)
+  {
+    result[upload_idx[i]] = std::move(uploaded[i]);
+  }
+  return result;
+}
+
+uint32_t count_rows(std::span<const row_chunk> chunks)
+{
+  return std::ranges::fold_left(chunks, 0u, [](uint32_t n, const row_chunk &c)
+                                { return n + c.num_rows; });
+}
+
+// A file of a plot with the columns and graphs that use it
+struct datafile
+{
+  std::string_view path;
+  std::vector<int> indices;
+  std::vector<const csv_data *> graphs;
+};
+
+// The costs of instructions of the VM for a batch of rows, relative to arithmetic. Builtins are
+// evaluated with the kernels of batch_math, which take a few times as long as arithmetic.
+uint32_t vm_cost(const vm_program &program)
+{
+  auto cost = 0u;
+  for (const auto &ins : program.code)
+  {
+    cost += ins.op == opcode::unary_call || ins.op == opcode::binary_call ? 8u : 1u;
+  }
+  return cost;
+}
+
+// Parsing a field takes about as long as this many arithmetic instructions of the VM.
+constexpr auto field_cost = 32u;
+
+// Evaluating the using expressions of a file while it is parsed saves uploading its columns and
+// the pass on the GPU, but the parser waits for the evaluation. It is chosen if the expressions
+// take at most about as long as parsing the rows and only use columns. User variables would be
+// inlined as literals by compile, so expressions using them keep the pass on the GPU. Returns the
+// programs of the graphs of f or nothing, if its columns are uploaded.
+std::vector<vm_program> cpu_programs(const datafile &f)
+{
+  auto result = std::vector<vm_program>();
+  auto cost = 0u;
+  for (const auto *g : f.graphs)
+  {
+    auto variables = std::vector<uint32_t>();
+    for (const auto &e : g->expressions)
+    {
+      used_variables(e, variables);
+    }
+    if (!variables.empty())
+    {
+      return {};
+    }
+    auto &program = result.emplace_back(compile(g->expressions));
+    if (!std::ranges::all_of(program.inputs, [](const vm_input &in)
+                             { return std::holds_alternative<data_ref>(in); }))
+    {
+      return {};
+    }
+    cost += vm_cost(program);
+  }
+  if (cost > field_cost * f.indices.size())
+  {
+    return {};
+  }
+  return result;
+}
+
+// (min, max) of the finite values of every component, or nothing if a component has none
+std::vector<glm::vec2> value_bounds(std::span<const float> values, std::size_t num_components)
+{
+  auto result = std::vector<glm::vec2>(
+      num_components,
+      glm::vec2(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()));
+  for (auto i = 0uz; i < values.size(); ++i)
+  {
+    if (std::isfinite(values[i]))
+    {
+      auto &b = result[i % num_components];
+      b.x = std::min(b.x, values[i]);
+      b.y = std::max(b.y, values[i]);
+    }
+  }
+  if (std::ranges::any_of(result, [](glm::vec2 b) { return b.x > b.y; }))
+  {
+    return {};
+  }
+  return result;
+}
+
+std::vector<row_data> read_datafiles(std::vector<datafile> &files, char separator,
+                                     datafile_engine engine, shared_timebase &timebase)
+{
+  auto programs = std::vector<std::vector<vm_program>>(files.size());
+  auto csv_files = std::vector<csv_file>();
+  auto evaluations = std::vector<csv_evaluation>();
+  for (auto i = 0uz; i < files.size(); ++i)
+  {
+    auto &f = files[i];
+    std::ranges::sort(f.indices);
+    f.indices.erase(std::ranges::unique(f.indices).begin(), f.indices.end());
+    // the GPU engine parses on the GPU, so the columns are already there
+    if (engine == datafile_engine::cpu && !f.indices.empty())
+    {
+      programs[i] = cpu_programs(f);
+    }
+    if (programs[i].empty())
+    {
+      csv_files.emplace_back(f.path, f.indices);
+    }
+    else
+    {
+      evaluations.emplace_back(f.path, f.indices, programs[i]);
     }
   }
+  // the evaluated files do not need the GL context, so they are parsed during the uploads
+  auto evaluating = std::async(std::launch::async, [&]
+                               { return evaluate_csv(evaluations, separator, timebase); });
+  auto chunks = read_rows(csv_files, separator, engine, timebase);
+  auto evaluated = evaluating.get();
 
   auto result = std::vector<row_data>();
   result.reserve(files.size());
-  auto timebase = std::optional<time_point>();
-  for (auto &[f, indices] : files)
-  {
-    std::ranges::sort(indices);
-    indices.erase(std::ranges::unique(indices).begin(), indices.end());
-    auto num_indices = indices.size();
-    auto data = num_indices > 0 ? read_csv(f, separator, indices, timebase) : std::vector<float>();
-    assert(data.size() % num_indices == 0);
-    auto num_points =
-        static_cast<uint32_t>(num_indices > 0 ? data.size() / num_indices : count_lines(f));
-    auto csv_vbo = make_vbo();
-    if (num_indices > 0)
+  auto next_chunks = chunks.begin();
+  auto next_evaluated = evaluated.begin();
+  for (auto i = 0uz; i < files.size(); ++i)
+  {
+    auto &f = files[i];
+    if (programs[i].empty())
+    {
+      auto num_points = f.indices.empty() ? count_lines(f.path) : count_rows(*next_chunks);
+      result.emplace_back(std::string(f.path), std::nullopt, std::move(f.indices), num_points,
+                          std::move(*next_chunks++));
+      continue;
+    }
+    auto &rows = result.emplace_back(std::string(f.path), std::nullopt, std::move(f.indices),
+                                     next_evaluated->num_rows, std::vector<row_chunk>());
+    for (auto g = 0uz; g < f.graphs.size(); ++g)
+    {
+      const auto &values = next_evaluated->values[g];
+      auto points =
+          evaluated_points{make_vbo(), value_bounds(values, programs[i][g].outputs.size())};
+      glBindBuffer(GL_ARRAY_BUFFER, points.vbo);
+      glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(values.size() * sizeof(float)),
+                   values.data(), GL_STATIC_DRAW);
+      rows.evaluated.emplace_back(f.graphs[g], std::move(points));
+    }
+    ++next_evaluated;
+  }
+  return result;
+}
+
+// Identifies the points of c by the path, size and last change of the file and the using
+// expressions with the user definitions inlined, so that other values of user variables are other
+// points. Nothing if the file cannot be found.
+// Besides the file and the expressions, the key contains every setting used while parsing the file:
+// the separator and the format of dates.
+std::optional<std::string> points_key(const csv_data &c, char separator)
+{
+  auto ec = std::error_code();
+  const auto changed = std::filesystem::last_write_time(c.path, ec);
+  if (ec)
+  {
+    return std::nullopt;
+  }
+  const auto size = std::filesystem::file_size(c.path, ec);
+  if (ec)
+  {
+    return std::nullopt;
+  }
+  auto key = c.path;
+  key.push_back('\0');
+  auto out = std::back_inserter(key);
+  fmt::format_to(out, "{} {} {:d} {}", changed.time_since_epoch().count(), size, separator,
+                 c.matrix);
+  key.push_back('\0');
+  key += settings::timefmt();
+  const auto dag = make_dag(c.expressions, user_inlining::all);
+  for (const auto &n : dag.nodes)
+  {
+    key.push_back('\0');
+    fmt::format_to(out, "{} {} {} {}", std::to_underlying(n.op), n.value, n.name, n.idx);
+    for (auto a : n.args)
+    {
+      fmt::format_to(out, " {}", a);
+    }
+  }
+  key.push_back('\0');
+  fmt::format_to(out, "{}", fmt::join(dag.roots, " "));
+  return key;
+}
+
+// the cached points of the datafiles of a plot by graph and the keys of the others
+struct cached_graphs
+{
+  std::vector<std::optional<std::string>> keys;
+  std::vector<std::optional<cached_points>> points;
+  // the timebase of the dates of the cached points and, after the files are read, of the plot
+  std::optional<time_point> timebase;
+  std::size_t budget;
+};
+
+template <typename G>
+cached_graphs find_cached_graphs(std::span<const G> gs, char separator, std::size_t budget)
+{
+  auto result = cached_graphs{std::vector<std::optional<std::string>>(gs.size()),
+                              std::vector<std::optional<cached_points>>(gs.size()),
+                              std::nullopt, budget};
+  for (auto i = 0uz; i < gs.size() && budget > 0; ++i)
+  {
+    const auto *c = std::get_if<csv_data>(&gs[i].data);
+    if (c == nullptr || !(result.keys[i] = points_key(*c, separator)))
+    {
+      continue;
+    }
+    auto points = find_cached_points(*result.keys[i]);
+    // the dates of all graphs must be relative to the same timebase, so the points are read again
+    // if theirs differs
+    if (!points.has_value()
+        || (points->timebase.has_value() && result.timebase.has_value()
+            && *points->timebase != *result.timebase))
+    {
+      continue;
+    }
+    if (points->timebase.has_value())
     {
-      auto vao = make_vao();
-      glBindVertexArray(vao);
-      glBindBuffer(GL_ARRAY_BUFFER, csv_vbo);
-      glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+      result.timebase = points->timebase;
     }
-    result.emplace_back(std::string(f), std::nullopt, std::move(indices), num_points,
-                        std::move(csv_vbo));
+    result.points[i] = std::move(points);
   }
-  return std::make_pair(std::move(result), timebase.value_or(time_point()));
+  return result;
 }
 
-std::pair<std::vector<row_data>, time_point>
-row_data_for_graphs(const std::span<const graph_desc_3d> gs, char separator)
+// the graphs with cached points are skipped and their timebase is the one of the plot
+std::pair<std::vector<row_data>, std::optional<time_point>>
+row_data_for_graphs(const std::span<const graph_desc_2d> gs, char separator,
+                    datafile_engine engine, const cached_graphs &cached)
 {
-  // using ordered map, because there is no std::hash for tuple or pair
-  auto files = std::map<std::tuple<std::string_view, bool>, std::vector<int>>();
-  for (const auto &g : gs)
+  auto files = std::vector<datafile>();
+  for (auto i = 0uz; i < gs.size(); ++i)
   {
-    if (g.data.index() != 1)
+    const auto &g = gs[i];
+    if (g.data.index() != 1 || cached.points[i].has_value())
     {
       continue;
     }
     else
     {
       const auto &d = std::get<1>(g.data);
-      auto &indices = files[{d.path, d.matrix}];
+      auto it = std::ranges::find(files, std::string_view(d.path), &datafile::path);
+      auto &f = it != files.end() ? *it : files.emplace_back(d.path);
       auto new_indices = extract_indices(d.expressions);
-      indices.reserve(indices.size() + new_indices.size());
-      std::ranges::copy(new_indices, std::back_inserter(indices));
+      f.indices.reserve(f.indices.size() + new_indices.size());
+      std::ranges::copy(new_indices, std::back_inserter(f.indices));
+      f.graphs.push_back(&d);
     }
   }
 
-  auto result = std::vector<row_data>();
-  result.reserve(files.size());
-  auto timebase = std::optional<time_point>();
-  for (auto &[p, indices] : files)
-  {
-    auto &[f, matrix] = p;
-    std::ranges::sort(indices);
-    indices.erase(std::ranges::unique(indices).begin(), indices.end());
-    auto num_indices = static_cast<uint32_t>(indices.size());
-    if (matrix)
+  auto timebase = shared_timebase();
+  if (cached.timebase.has_value())
+  {
+    timebase.get_or_set(*cached.timebase);
+  }
+  auto result = read_datafiles(files, separator, engine, timebase);
+  return std::make_pair(std::move(result), timebase.get());
+}
+
+std::pair<std::vector<row_data>, std::optional<time_point>>
+row_data_for_graphs(const std::span<const graph_desc_3d> gs, char separator,
+                    datafile_engine engine, const cached_graphs &cached)
+{
+  auto files = std::vector<datafile>();
+  auto matrix_files = std::vector<datafile>();
+  for (auto i = 0uz; i < gs.size(); ++i)
+  {
+    const auto &g = gs[i];
+    if (g.data.index() != 1 || cached.points[i].has_value())
     {
-      auto [data, columns] = read_matrix_csv(f, separator, timebase);
-      assert(data.size() % 3 == 0);
-      auto num_points = static_cast<uint32_t>(data.size() / 3);
-      assert(num_points % columns == 0);
-      auto csv_vbo = make_vbo();
-      glBindVertexArray(0);
-      glBindBuffer(GL_ARRAY_BUFFER, csv_vbo);
-      glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-      result.emplace_back(std::string(f), columns, std::move(indices), num_points,
-                          std::move(csv_vbo));
+      continue;
     }
     else
     {
-      auto data = [&]
-      {
-        if (num_indices == 0)
-        {
-          return std::vector<float>();
-        }
-        else
-        {
-          return read_csv(f, separator, indices, timebase);
-        }
-      }();
-      assert(data.size() % num_indices == 0);
-      auto num_points =
-          static_cast<uint32_t>(num_indices > 0 ? data.size() / num_indices : count_lines(f));
-      auto csv_vbo = make_vbo();
-      if (num_indices > 0)
-      {
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, csv_vbo);
-        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-      }
-      result.emplace_back(std::string(f), std::nullopt, std::move(indices), num_points,
-                          std::move(csv_vbo));
+      const auto &d = std::get<1>(g.data);
+      auto &same_kind = d.matrix ? matrix_files : files;
+      auto it = std::ranges::find(same_kind, std::string_view(d.path), &datafile::path);
+      auto &f = it != same_kind.end() ? *it : same_kind.emplace_back(d.path);
+      auto new_indices = extract_indices(d.expressions);
+      f.indices.reserve(f.indices.size() + new_indices.size());
+      std::ranges::copy(new_indices, std::back_inserter(f.indices));
+      f.graphs.push_back(&d);
+    }
+  }
+
+  auto timebase = shared_timebase();
+  if (cached.timebase.has_value())
+  {
+    timebase.get_or_set(*cached.timebase);
+  }
+  auto result = read_datafiles(files, separator, engine, timebase);
+  for (auto &f : matrix_files)
+  {
+    auto matrix_timebase = timebase.get();
+    auto [data, columns] = read_matrix_csv(f.path, separator, matrix_timebase);
+    if (matrix_timebase.has_value())
+    {
+      timebase.get_or_set(*matrix_timebase);
     }
+    assert(data.size() % 3 == 0);
+    auto num_points = static_cast<uint32_t>(data.size() / 3);
+    assert(num_points % columns == 0);
+    auto csv_vbo = make_vbo();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, csv_vbo);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+    auto matrix_chunks = std::vector<row_chunk>();
+    matrix_chunks.emplace_back(std::move(csv_vbo), num_points);
+    std::ranges::sort(f.indices);
+    f.indices.erase(std::ranges::unique(f.indices).begin(), f.indices.end());
+    result.emplace_back(std::string(f.path), columns, std::move(f.indices), num_points,
+                        std::move(matrix_chunks));
   }
-  return std::make_pair(std::move(result), timebase.value_or(time_point()));
+  return std::make_pair(std::move(result), timebase.get());
 }
 
-vbo_handle data_for_using_expressions(std::span<const expr> exprs, const row_data &r)
+// Compute shaders write the points directly into the vbo, so they are not limited by the number of
+// varyings. Every workgroup reduces the bounds of each component of its points in shared memory and
+// merges them into bounds with one atomic per component. Floats are mapped to uints of the same
+// order, because there are no atomics for floats. Infinite values and NaNs are not part of the
+// bounds. A pass of num_points points is evaluated in dispatches of chunks of it. _i is the index
+// of a point in the pass and _j its index in the chunk, whose first point is stored at first_point.
+constexpr auto compute_shader_fmt = R"(#version 430 core
+layout(local_size_x = {0}) in;
+layout(std430, binding = 1) writeonly buffer values_block {{ float _values[]; }};
+layout(std430, binding = 2) buffer bounds_block {{ uint _bounds[]; }};
+uniform uint num_points;
+uniform uint first_point;
+uniform uint chunk_offset;
+{1}
+shared uint _group_min[{2}];
+shared uint _group_max[{2}];
+
+uint _ordered(float f)
+{{
+  uint u = floatBitsToUint(f);
+  return (u & 0x80000000u) != 0u ? ~u : u | 0x80000000u;
+}}
+
+{3}
+
+void main()
+{{
+  uint _j = gl_GlobalInvocationID.x;
+  uint _i = chunk_offset + _j;
+  for (uint _k = gl_LocalInvocationIndex; _k < {2}u; _k += gl_WorkGroupSize.x)
+  {{
+    _group_min[_k] = 0xffffffffu;
+    _group_max[_k] = 0u;
+  }}
+  barrier();
+  if (_i < num_points)
+  {{
+    {4}
+    float _out[{2}];
+    {5}
+    for (uint _k = 0u; _k < {2}u; ++_k)
+    {{
+      if (!isnan(_out[_k]) && !isinf(_out[_k]))
+      {{
+        atomicMin(_group_min[_k], _ordered(_out[_k]));
+        atomicMax(_group_max[_k], _ordered(_out[_k]));
+      }}
+    }}
+  }}
+  barrier();
+  for (uint _k = gl_LocalInvocationIndex; _k < {2}u; _k += gl_WorkGroupSize.x)
+  {{
+    atomicMin(_bounds[2u * _k], _group_min[_k]);
+    atomicMax(_bounds[2u * _k + 1u], _group_max[_k]);
+  }}
+}}
+)";
+
+// Output k of point i is stored at base + i * stride. Without a layout, the outputs of a point
+// are stored next to each other.
+struct output_layout
 {
-  const auto num_indices = r.indices.size();
-  const auto num_points = r.num_points;
-  auto vao = make_vao();
-  glBindVertexArray(vao);
-  auto &csv_vbo = r.vbo;
-  glBindBuffer(GL_ARRAY_BUFFER, csv_vbo);
-  for (auto i = 0U; i < num_indices; ++i)
+  uint32_t base;
+  uint32_t stride;
+};
+
+// declarations are added before main and setup at the start of main
+program_handle compute_program_for_expressions(std::span<const expr> exprs,
+                                               std::string_view declarations,
+                                               std::string_view setup,
+                                               std::span<const int> indices,
+                                               std::string_view row_number,
+                                               uint32_t workgroup_size,
+                                               std::span<const output_layout> layout = {})
+{
+  assert(layout.empty() || layout.size() == exprs.size());
+  const auto code = to_glsl(exprs, indices, "_c", row_number);
+  auto outputs = std::string();
+  for (auto i = 0uz; i < exprs.size(); ++i)
   {
-    glEnableVertexAttribArray(i);
-    glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, num_indices * sizeof(float),
-                          (void *)(i * sizeof(float)));
+    const auto l = layout.empty() ? output_layout{static_cast<uint32_t>(i),
+                                                  static_cast<uint32_t>(exprs.size())}
+                                  : layout[i];
+    fmt::format_to(std::back_inserter(outputs),
+                   "_out[{0}] = {1};\n_values[{2}u + (first_point + _j) * {3}u] = _out[{0}];\n", i,
+                   code.values[i], l.base, l.stride);
   }
-  auto data_vbo = make_vbo();
-  glBindBuffer(GL_ARRAY_BUFFER, data_vbo);
-  glBufferData(GL_ARRAY_BUFFER, exprs.size() * num_points * sizeof(float), nullptr,
-               GL_DYNAMIC_DRAW);
-  auto program = program_for_using_expressions(exprs, r.indices);
+  const auto src = fmt::format(compute_shader_fmt, workgroup_size, declarations, exprs.size(),
+                               glsl_definitions(exprs), fmt::format("{}{}", setup, code.locals),
+                               outputs);
+  return with_user_variables(make_compute_program(src.c_str()), exprs);
+}
+
+// The number of points of one draw or dispatch, which writes point_bytes per point. Drivers limit
+// the size of buffer bindings and long draws stall the GPU, so larger results are evaluated in
+// chunks. It is a multiple of the workgroup size, so that only the last dispatch of a pass has
+// invocations past its points.
+uint32_t chunk_points(const evaluation_setting &evaluation, std::size_t point_bytes)
+{
+  const auto workgroup_size = std::size_t{evaluation.workgroup_size};
+  // every implementation supports at least 65535 workgroups in a dispatch
+  const auto points =
+      std::clamp(evaluation.budget / point_bytes, workgroup_size, 65535uz * workgroup_size);
+  return static_cast<uint32_t>(points - points % workgroup_size);
+}
+
+// a dispatch of a compute program for num_points points of a pass starting at chunk_offset, which
+// are stored from first_point on. The program has to be in use.
+void dispatch_chunk(gl_id program, uint32_t chunk_offset, uint32_t num_points,
+                    uint32_t first_point, uint32_t workgroup_size)
+{
+  glUniform1ui(glGetUniformLocation(program, "chunk_offset"), chunk_offset);
+  glUniform1ui(glGetUniformLocation(program, "first_point"), first_point);
+  glDispatchCompute((num_points + workgroup_size - 1) / workgroup_size, 1, 1);
+}
+
+// evaluates a pass of num_points points, which are stored from first_point on
+void dispatch_points(gl_id program, uint32_t first_point, uint32_t num_points,
+                     uint32_t workgroup_size, uint32_t max_points)
+{
   glUseProgram(program);
-  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, data_vbo);
-  glBeginTransformFeedback(GL_POINTS);
-  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(num_points));
-  glEndTransformFeedback();
-  return data_vbo;
+  glUniform1ui(glGetUniformLocation(program, "num_points"), num_points);
+  for (auto offset = 0u; offset < num_points; offset += max_points)
+  {
+    dispatch_chunk(program, offset, std::min(max_points, num_points - offset),
+                   first_point + offset, workgroup_size);
+  }
 }
 
-std::tuple<vbo_handle, seq_data_desc>
-data_for_expression_2d(mark_type_2d m, const expr &e, uint32_t num_points, range_setting xrange)
+evaluated_points allocate_points(std::size_t num_components, uint32_t num_points)
 {
-  auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
-                          xrange.lower_bound.value_or(-10.0f));
-  auto max_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
-                          xrange.upper_bound.value_or(10.0f));
-  const auto step_x = (max_x - min_x) / static_cast<float>(num_points - 1);
-  auto vao = make_vao();
-  auto exprs = m == mark_type_2d::impulses
-                   ? std::vector<expr>{var("x"), literal_expr(0.0f), var("x"), e}
-                   : std::vector<expr>{var("x"), e};
-  auto program = program_for_functional_data_2d(exprs);
-  auto vbo = make_vbo();
-  glBindVertexArray(vao);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, exprs.size() * num_points * sizeof(float), nullptr,
+  auto result = evaluated_points{make_vbo(), {}};
+  glBindBuffer(GL_ARRAY_BUFFER, result.vbo);
+  glBufferData(GL_ARRAY_BUFFER, num_components * num_points * sizeof(float), nullptr,
                GL_DYNAMIC_DRAW);
-  glUseProgram(program);
-  glUniform1f(glGetUniformLocation(program, "min_x"), min_x);
-  glUniform1f(glGetUniformLocation(program, "step_x"), step_x);
-  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo);
-  glBeginTransformFeedback(GL_POINTS);
-  glDrawArraysInstanced(GL_POINTS, 0, 1, num_points);
-  glEndTransformFeedback();
-  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, result.vbo);
+  return result;
+}
 
-  return std::make_tuple(std::move(vbo),
-                         seq_data_desc(static_cast<uint32_t>(exprs.size()), num_points));
+vbo_handle make_bounds_buffer(std::size_t num_components)
+{
+  auto initial = std::vector<uint32_t>();
+  for (auto i = 0uz; i < num_components; ++i)
+  {
+    initial.push_back(0xffffffffu);
+    initial.push_back(0u);
+  }
+  auto bounds = make_vbo();
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, bounds);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, initial.size() * sizeof(uint32_t), initial.data(),
+               GL_STREAM_READ);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, bounds);
+  return bounds;
 }
 
-std::tuple<vbo_handle, seq_data_desc>
-data_for_parametric_2d(const expr (&exprs)[2], uint32_t num_points, range_setting trange)
+float from_ordered(uint32_t u)
+{
+  return std::bit_cast<float>((u & 0x80000000u) != 0u ? u & 0x7fffffffu : ~u);
+}
+
+// the bounds of every component, which are empty, if the component has no finite value
+std::vector<std::optional<glm::vec2>> read_component_bounds(gl_id bounds,
+                                                            std::size_t num_components)
+{
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT
+                  | GL_BUFFER_UPDATE_BARRIER_BIT);
+  auto ordered = std::vector<uint32_t>(2 * num_components);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, bounds);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, ordered.size() * sizeof(uint32_t),
+                     ordered.data());
+  auto result = std::vector<std::optional<glm::vec2>>();
+  for (auto i = 0uz; i < num_components; ++i)
+  {
+    if (ordered[2 * i] > ordered[2 * i + 1])
+    {
+      result.emplace_back();
+    }
+    else
+    {
+      result.emplace_back(
+          glm::vec2(from_ordered(ordered[2 * i]), from_ordered(ordered[2 * i + 1])));
+    }
+  }
+  return result;
+}
+
+// the bounds of all components, which are empty, if any component has no finite value
+std::vector<glm::vec2> all_bounds(std::span<const std::optional<glm::vec2>> components)
+{
+  auto result = std::vector<glm::vec2>();
+  for (const auto &c : components)
+  {
+    if (!c)
+    {
+      return {};
+    }
+    result.push_back(*c);
+  }
+  return result;
+}
+
+std::vector<glm::vec2> read_bounds(gl_id bounds, std::size_t num_components)
+{
+  return all_bounds(read_component_bounds(bounds, num_components));
+}
+
+// Components are alternately x and y for 2d points and x, y, z and possibly a color for 3d points.
+std::optional<rect> bounds_rect(std::span<const glm::vec2> bounds, uint32_t dims)
+{
+  if (bounds.size() < dims)
+  {
+    return std::nullopt;
+  }
+  const auto empty =
+      glm::vec2(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+  auto axes = std::array<glm::vec2, 3>{empty, empty, dims == 2 ? glm::vec2(-1.0f, 1.0f) : empty};
+  for (auto i = 0uz; i < bounds.size() && (dims == 2 || i < 3); ++i)
+  {
+    auto &axis = axes[i % dims];
+    axis.x = std::min(axis.x, bounds[i].x);
+    axis.y = std::max(axis.y, bounds[i].y);
+  }
+  return bounding_rect(axes[0], axes[1], axes[2]);
+}
+
+// Variables of sampled expressions. Point i is point i % per_line of line i / per_line and a
+// variable is min + line * line_step + point * point_step.
+struct sample_pass
+{
+  uint32_t first_point;
+  uint32_t num_points;
+  uint32_t per_line;
+  // min, line step and point step of every variable
+  std::vector<glm::vec3> samples;
+};
+
+program_handle sampled_program(std::span<const expr> exprs,
+                               std::span<const std::string_view> variables,
+                               uint32_t workgroup_size, std::span<const output_layout> layout)
+{
+  auto declarations = std::string("uniform uint per_line;\n");
+  auto setup = std::string();
+  for (auto v : variables)
+  {
+    fmt::format_to(std::back_inserter(declarations),
+                   "uniform float min_{0};\nuniform float line_step_{0};\n"
+                   "uniform float point_step_{0};\n",
+                   v);
+    fmt::format_to(std::back_inserter(setup),
+                   "float {0} = min_{0} + float(_i / per_line) * line_step_{0} + float(_i % "
+                   "per_line) * point_step_{0};\n",
+                   v);
+  }
+  return compute_program_for_expressions(exprs, declarations, setup, {}, "0.0", workgroup_size,
+                                         layout);
+}
+
+void use_sample_pass(gl_id program, std::span<const std::string_view> variables,
+                     const sample_pass &p)
+{
+  glUseProgram(program);
+  glUniform1ui(glGetUniformLocation(program, "per_line"), p.per_line);
+  for (auto i = 0uz; i < variables.size(); ++i)
+  {
+    const auto v = variables[i];
+    glUniform1f(glGetUniformLocation(program, fmt::format("min_{}", v).c_str()), p.samples[i].x);
+    glUniform1f(glGetUniformLocation(program, fmt::format("line_step_{}", v).c_str()),
+                p.samples[i].y);
+    glUniform1f(glGetUniformLocation(program, fmt::format("point_step_{}", v).c_str()),
+                p.samples[i].z);
+  }
+}
+
+void dispatch_sampled(gl_id program, std::span<const std::string_view> variables,
+                      std::span<const sample_pass> passes, uint32_t workgroup_size,
+                      uint32_t max_points)
+{
+  for (const auto &p : passes)
+  {
+    use_sample_pass(program, variables, p);
+    dispatch_points(program, p.first_point, p.num_points, workgroup_size, max_points);
+  }
+}
+
+evaluated_points evaluate_sampled(std::span<const expr> exprs,
+                                  std::span<const std::string_view> variables,
+                                  std::span<const sample_pass> passes,
+                                  const evaluation_setting &evaluation)
+{
+  auto program = sampled_program(exprs, variables, evaluation.workgroup_size, {});
+  auto num_points = 0u;
+  for (const auto &p : passes)
+  {
+    num_points = std::max(num_points, p.first_point + p.num_points);
+  }
+  auto result = allocate_points(exprs.size(), num_points);
+  auto bounds = make_bounds_buffer(exprs.size());
+  dispatch_sampled(program, variables, passes, evaluation.workgroup_size,
+                   chunk_points(evaluation, exprs.size() * sizeof(float)));
+  result.bounds = read_bounds(bounds, exprs.size());
+  return result;
+}
+
+// The rows of every chunk are read from a shader storage buffer, row by row.
+evaluated_points evaluate_rows(std::span<const expr> exprs, const row_data &r,
+                               const evaluation_setting &evaluation)
+{
+  const auto workgroup_size = evaluation.workgroup_size;
+  const auto max_points = chunk_points(evaluation, exprs.size() * sizeof(float));
+  const auto num_indices = static_cast<uint32_t>(r.indices.size());
+  auto declarations = std::string();
+  auto setup = std::string();
+  if (num_indices > 0)
+  {
+    declarations = "layout(std430, binding = 0) readonly buffer rows_block { float _rows[]; };\n";
+    setup = fmt::format("float row[{0}];\nfor (uint _j = 0u; _j < {0}u; ++_j)\n{{\n  row[_j] = "
+                        "_rows[_i * {0}u + _j];\n}}\n",
+                        num_indices);
+  }
+  auto program = compute_program_for_expressions(exprs, declarations, setup, r.indices,
+                                                 "float(first_point + _j)", workgroup_size);
+  auto result = allocate_points(exprs.size(), r.num_points);
+  auto bounds = make_bounds_buffer(exprs.size());
+  if (r.chunks.empty())
+  {
+    dispatch_points(program, 0, r.num_points, workgroup_size, max_points);
+  }
+  auto offset = 0u;
+  for (const auto &chunk : r.chunks)
+  {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, chunk.vbo);
+    dispatch_points(program, offset, chunk.num_rows, workgroup_size, max_points);
+    offset += chunk.num_rows;
+  }
+  result.bounds = read_bounds(bounds, exprs.size());
+  return result;
+}
+
+// Draws num_points points with transform feedback into vbo, which stores them from first_point
+// on, in draws of at most max_points points. gl_VertexID is the index of a point in the draws.
+void feedback_points(gl_id vbo, uint32_t first_point, uint32_t num_points, std::size_t point_bytes,
+                     uint32_t max_points)
+{
+  for (auto offset = 0u; offset < num_points; offset += max_points)
+  {
+    const auto n = std::min(max_points, num_points - offset);
+    glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo,
+                      static_cast<GLintptr>((first_point + offset) * point_bytes),
+                      static_cast<GLsizeiptr>(n * point_bytes));
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, static_cast<GLint>(offset), static_cast<GLsizei>(n));
+    glEndTransformFeedback();
+  }
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+}
+
+evaluated_points data_for_using_expressions(std::span<const expr> exprs, const row_data &r,
+                                            const evaluation_setting &evaluation)
+{
+  if (evaluation.engine == expression_engine::compute)
+  {
+    return evaluate_rows(exprs, r, evaluation);
+  }
+  const auto num_indices = r.indices.size();
+  const auto num_points = r.num_points;
+  auto vao = make_vao();
+  glBindVertexArray(vao);
+  auto data_vbo = make_vbo();
+  glBindBuffer(GL_ARRAY_BUFFER, data_vbo);
+  glBufferData(GL_ARRAY_BUFFER, exprs.size() * num_points * sizeof(float), nullptr,
+               GL_DYNAMIC_DRAW);
+  auto program = program_for_using_expressions(exprs, r.indices);
+  glUseProgram(program);
+  const auto point_bytes = exprs.size() * sizeof(float);
+  const auto max_points = chunk_points(evaluation, point_bytes);
+  if (r.chunks.empty())
+  {
+    feedback_points(data_vbo, 0, num_points, point_bytes, max_points);
+    return evaluated_points{std::move(data_vbo), {}};
+  }
+
+  const auto row_offset = glGetUniformLocation(program, "row_offset");
+  auto offset = 0u;
+  for (const auto &chunk : r.chunks)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    for (auto i = 0U; i < num_indices; ++i)
+    {
+      glEnableVertexAttribArray(i);
+      glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, num_indices * sizeof(float),
+                            (void *)(i * sizeof(float)));
+    }
+    glUniform1f(row_offset, static_cast<float>(offset));
+    feedback_points(data_vbo, offset, chunk.num_rows, point_bytes, max_points);
+    offset += chunk.num_rows;
+  }
+  return evaluated_points{std::move(data_vbo), {}};
+}
+
+// the points of the graph of c, whose file was read into r
+evaluated_points data_for_csv(const csv_data &c, row_data &r, const evaluation_setting &evaluation)
+{
+  for (auto &[graph, points] : r.evaluated)
+  {
+    if (graph == &c)
+    {
+      return std::move(points);
+    }
+  }
+  return data_for_using_expressions(c.expressions, r, evaluation);
+}
+
+// Conditions in using expressions filter rows with NaN, like using 1:($3 > 0 ? $2 : NaN). kept[i]
+// is 1 if no component of point i is NaN or infinite and 0 otherwise.
+constexpr auto keep_shader = R"(#version 430 core
+layout(local_size_x = 256) in;
+layout(std430, binding = 0) readonly buffer points_block { float points[]; };
+layout(std430, binding = 1) writeonly buffer kept_block { float kept[]; };
+uniform uint num_points;
+uniform uint point_size;
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i < num_points)
+  {
+    bool keep = true;
+    for (uint c = 0u; c < point_size; ++c)
+    {
+      float v = points[i * point_size + c];
+      keep = keep && !isnan(v) && !isinf(v);
+    }
+    kept[i] = keep ? 1.0 : 0.0;
+  }
+}
+)";
+
+// After the prefix sum, kept[i] is the number of kept points up to and including point i.
+constexpr auto compact_shader = R"(#version 430 core
+layout(local_size_x = 256) in;
+layout(std430, binding = 0) readonly buffer points_block { float points[]; };
+layout(std430, binding = 1) readonly buffer kept_block { float kept[]; };
+layout(std430, binding = 2) writeonly buffer compacted_block { float compacted[]; };
+uniform uint num_points;
+uniform uint point_size;
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i < num_points)
+  {
+    uint first = i == 0u ? 0u : uint(kept[i - 1u]);
+    if (uint(kept[i]) != first)
+    {
+      for (uint c = 0u; c < point_size; ++c)
+      {
+        compacted[first * point_size + c] = points[i * point_size + c];
+      }
+    }
+  }
+}
+)";
+
+// whether exprs have a condition, which is not folded
+bool filters_rows(std::span<const expr> exprs)
+{
+  return std::ranges::any_of(make_dag(exprs, user_inlining::all).nodes,
+                             [](const dag_node &n) { return n.op == dag_op::select; });
+}
+
+// Removes the points with a NaN or infinite component from vbo with a stream compaction on the
+// GPU, so that draws only process the kept points. Returns their number. The counts of the prefix
+// sum are floats, which are exact up to 2^24, so more points are kept as they are.
+uint32_t compact_points(vbo_handle &vbo, uint32_t num_points, uint32_t point_size)
+{
+  if (num_points == 0 || num_points > 1u << 24)
+  {
+    return num_points;
+  }
+  auto kept = make_vbo();
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, kept);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, num_points * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+  auto keep = make_compute_program(keep_shader);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vbo);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, kept);
+  glUseProgram(keep);
+  glUniform1ui(glGetUniformLocation(keep, "num_points"), num_points);
+  glUniform1ui(glGetUniformLocation(keep, "point_size"), point_size);
+  glDispatchCompute((num_points + 255) / 256, 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+  prefix_sum(kept, num_points);
+
+  auto total = 0.0f;
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, kept);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, (num_points - 1) * sizeof(float), sizeof(float),
+                     &total);
+  const auto num_kept = static_cast<uint32_t>(total);
+  if (num_kept == num_points)
+  {
+    return num_points;
+  }
+
+  auto compacted = make_vbo();
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, compacted);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(num_kept, 1u) * point_size * sizeof(float),
+               nullptr, GL_STATIC_DRAW);
+  auto compact = make_compute_program(compact_shader);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vbo);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, kept);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, compacted);
+  glUseProgram(compact);
+  glUniform1ui(glGetUniformLocation(compact, "num_points"), num_points);
+  glUniform1ui(glGetUniformLocation(compact, "point_size"), point_size);
+  glDispatchCompute((num_points + 255) / 256, 1, 1);
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+  vbo = std::move(compacted);
+  return num_kept;
+}
+
+// the points of the graph with index graph, which are either cached or evaluated from the rows of
+// its file, which find_rows returns, and then cached
+template <typename F>
+cached_points points_for_csv(const csv_data &c, std::size_t graph, cached_graphs &cached,
+                             F find_rows, const evaluation_setting &evaluation)
+{
+  if (cached.points[graph].has_value())
+  {
+    return std::move(*cached.points[graph]);
+  }
+  row_data &rd = find_rows();
+  auto [vbo, bounds] = data_for_csv(c, rd, evaluation);
+  auto num_points = rd.num_points;
+  // the points of a matrix are a grid, which has no gaps
+  if (!c.matrix && filters_rows(c.expressions))
+  {
+    num_points = compact_points(vbo, num_points, static_cast<uint32_t>(c.expressions.size()));
+  }
+  auto points = cached_points{std::move(vbo), num_points, rd.columns, std::move(bounds),
+                             cached.timebase};
+  const auto bytes = num_points * c.expressions.size() * sizeof(float);
+  if (cached.keys[graph].has_value() && bytes <= cached.budget)
+  {
+    cache_points(std::move(*cached.keys[graph]), points, bytes, cached.budget);
+  }
+  return points;
+}
+
+// the components of a point of a function graph
+std::vector<expr> exprs_for_function_2d(mark_type_2d m, const expr &e)
+{
+  return m == mark_type_2d::impulses
+             ? std::vector<expr>{var("x"), literal_expr(0.0f), var("x"), e}
+             : std::vector<expr>{var("x"), e};
+}
+
+void feedback_function_2d(gl_id vbo, std::span<const expr> exprs, uint32_t num_points,
+                          float min_x, float step_x, const evaluation_setting &evaluation)
+{
+  auto program = program_for_functional_data_2d(exprs);
+  glUseProgram(program);
+  glUniform1f(glGetUniformLocation(program, "min_x"), min_x);
+  glUniform1f(glGetUniformLocation(program, "step_x"), step_x);
+  const auto point_bytes = exprs.size() * sizeof(float);
+  feedback_points(vbo, 0, num_points, point_bytes, chunk_points(evaluation, point_bytes));
+}
+
+std::tuple<vbo_handle, seq_data_desc>
+data_for_expression_2d(mark_type_2d m, const expr &e, uint32_t num_points, range_setting xrange,
+                       const evaluation_setting &evaluation)
+{
+  auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
+                          xrange.lower_bound.value_or(-10.0f));
+  auto max_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
+                          xrange.upper_bound.value_or(10.0f));
+  const auto step_x = (max_x - min_x) / static_cast<float>(num_points - 1);
+  auto vao = make_vao();
+  auto exprs = exprs_for_function_2d(m, e);
+  if (evaluation.engine == expression_engine::compute)
+  {
+    const auto variables = std::array{"x"sv};
+    const auto pass = sample_pass{0, num_points, num_points, {{min_x, 0.0f, step_x}}};
+    auto [vbo, bounds] = evaluate_sampled(exprs, variables, {&pass, 1}, evaluation);
+    auto desc = seq_data_desc(static_cast<uint32_t>(exprs.size()), num_points);
+    desc.bounds = bounds_rect(bounds, 2);
+    return std::make_tuple(std::move(vbo), std::move(desc));
+  }
+  auto vbo = make_vbo();
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, exprs.size() * num_points * sizeof(float), nullptr,
+               GL_DYNAMIC_DRAW);
+  feedback_function_2d(vbo, exprs, num_points, min_x, step_x, evaluation);
+
+  return std::make_tuple(std::move(vbo),
+                         seq_data_desc(static_cast<uint32_t>(exprs.size()), num_points));
+}
+
+// Writes the points of a function graph to vbo, which already holds num_points of them. Nothing
+// is read back, so the GPU is not waited for. This is what changing a bound or animated variable
+// costs every frame.
+void update_expression_2d(gl_id vbo, mark_type_2d m, const expr &e, uint32_t num_points,
+                          range_setting xrange, const evaluation_setting &evaluation)
+{
+  auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
+                          xrange.lower_bound.value_or(-10.0f));
+  auto max_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
+                          xrange.upper_bound.value_or(10.0f));
+  const auto step_x = (max_x - min_x) / static_cast<float>(num_points - 1);
+  auto vao = make_vao();
+  glBindVertexArray(vao);
+  auto exprs = exprs_for_function_2d(m, e);
+  if (evaluation.engine == expression_engine::compute)
+  {
+    const auto variables = std::array{"x"sv};
+    const auto pass = sample_pass{0, num_points, num_points, {{min_x, 0.0f, step_x}}};
+    auto program = sampled_program(exprs, variables, evaluation.workgroup_size, {});
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vbo);
+    // the program updates bounds, which are not needed
+    auto bounds = make_bounds_buffer(exprs.size());
+    dispatch_sampled(program, variables, {&pass, 1}, evaluation.workgroup_size,
+                     chunk_points(evaluation, exprs.size() * sizeof(float)));
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    return;
+  }
+  feedback_function_2d(vbo, exprs, num_points, min_x, step_x, evaluation);
+}
+
+// All function graphs of a 2d plot share the sampling of x, so they are evaluated by one compute
+// program, whatever the engine. Transform feedback could not write that many components. The
+// points are evaluated in chunks into a scratch buffer, in which the points of every graph are a
+// slice. The slices are copied to the vbos of the graphs after every chunk.
+std::vector<std::tuple<vbo_handle, seq_data_desc>>
+data_for_expressions_2d(std::span<const std::pair<mark_type_2d, const expr *>> graphs,
+                        uint32_t num_points, range_setting xrange,
+                        const evaluation_setting &evaluation)
+{
+  auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
+                          xrange.lower_bound.value_or(-10.0f));
+  auto max_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
+                          xrange.upper_bound.value_or(10.0f));
+  const auto step_x = (max_x - min_x) / static_cast<float>(num_points - 1);
+
+  auto exprs = std::vector<expr>();
+  // first component of every graph and one past the last
+  auto first = std::vector<uint32_t>{0};
+  for (const auto &[m, e] : graphs)
+  {
+    const auto graph_exprs = exprs_for_function_2d(m, *e);
+    std::ranges::move(graph_exprs, std::back_inserter(exprs));
+    first.push_back(static_cast<uint32_t>(exprs.size()));
+  }
+  const auto max_points =
+      std::min(num_points, chunk_points(evaluation, exprs.size() * sizeof(float)));
+  auto layout = std::vector<output_layout>();
+  for (auto g = 0uz; g < graphs.size(); ++g)
+  {
+    const auto point_size = first[g + 1] - first[g];
+    for (auto c = 0u; c < point_size; ++c)
+    {
+      layout.push_back(output_layout{first[g] * max_points + c, point_size});
+    }
+  }
+
+  const auto variables = std::array{"x"sv};
+  const auto pass = sample_pass{0, num_points, num_points, {{min_x, 0.0f, step_x}}};
+  auto program = sampled_program(exprs, variables, evaluation.workgroup_size, layout);
+  auto scratch = allocate_points(exprs.size(), max_points);
+  auto bounds = make_bounds_buffer(exprs.size());
+
+  auto vbos = std::vector<vbo_handle>();
+  vbos.reserve(graphs.size());
+  for (auto g = 0uz; g < graphs.size(); ++g)
+  {
+    vbos.push_back(make_vbo());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbos.back());
+    glBufferData(GL_COPY_WRITE_BUFFER, (first[g + 1] - first[g]) * num_points * sizeof(float),
+                 nullptr, GL_DYNAMIC_DRAW);
+  }
+
+  use_sample_pass(program, variables, pass);
+  glUniform1ui(glGetUniformLocation(program, "num_points"), num_points);
+  glBindBuffer(GL_COPY_READ_BUFFER, scratch.vbo);
+  for (auto offset = 0u; offset < num_points; offset += max_points)
+  {
+    const auto n = std::min(max_points, num_points - offset);
+    dispatch_chunk(program, offset, n, 0, evaluation.workgroup_size);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    for (auto g = 0uz; g < graphs.size(); ++g)
+    {
+      const auto point_bytes = (first[g + 1] - first[g]) * sizeof(float);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, vbos[g]);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                          static_cast<GLintptr>(first[g] * max_points * sizeof(float)),
+                          static_cast<GLintptr>(offset * point_bytes),
+                          static_cast<GLsizeiptr>(n * point_bytes));
+    }
+  }
+  // a function without finite values only loses the bounds of its own graph
+  const auto component_bounds = read_component_bounds(bounds, exprs.size());
+
+  auto result = std::vector<std::tuple<vbo_handle, seq_data_desc>>();
+  result.reserve(graphs.size());
+  for (auto g = 0uz; g < graphs.size(); ++g)
+  {
+    const auto point_size = first[g + 1] - first[g];
+    auto desc = seq_data_desc(point_size, num_points);
+    if (const auto graph_bounds =
+            all_bounds(std::span(component_bounds).subspan(first[g], point_size));
+        !graph_bounds.empty())
+    {
+      desc.bounds = bounds_rect(graph_bounds, 2);
+    }
+    result.emplace_back(std::move(vbos[g]), std::move(desc));
+  }
+  return result;
+}
+
+// The size of the plot is not known when its data is generated. The error of adaptive sampling is
+// measured as if the plot covered a screen of this size.
+constexpr auto adaptive_screen_size = glm::vec2(1920.0f, 1080.0f);
+
+// counts[i] is 2 if the interval from point i to point i + 1 is subdivided and 1 otherwise. The
+// error of an interval is the distance of the curve at its midpoint to the line segment, which is a
+// second difference. Intervals narrower than 1/16 pixel are not subdivided, so that jumps do not
+// split forever. Intervals at the boundary of the domain of the function are always subdivided.
+constexpr auto refine_shader_fmt = R"(#version 430 core
+layout(local_size_x = {0}) in;
+layout(std430, binding = 0) readonly buffer xs_block {{ float _xs[]; }};
+layout(std430, binding = 1) writeonly buffer counts_block {{ float _counts[]; }};
+uniform uint num_points;
+uniform vec2 pixel_scale;
+
+{1}
+
+float _f(float x)
+{{
+  {2}
+  return {3};
+}}
+
+bool _finite(float y) {{ return !isnan(y) && !isinf(y); }}
+
+void main()
+{{
+  uint _i = gl_GlobalInvocationID.x;
+  if (_i + 1u < num_points)
+  {{
+    float _x0 = _xs[_i];
+    float _x1 = _xs[_i + 1u];
+    float _y0 = _f(_x0);
+    float _y1 = _f(_x1);
+    float _ym = _f(0.5 * (_x0 + _x1));
+    bool _split = _finite(_y0) && _finite(_y1) && _finite(_ym)
+                      ? abs(_ym - 0.5 * (_y0 + _y1)) * pixel_scale.y > 0.5
+                      : _finite(_y0) || _finite(_y1) || _finite(_ym);
+    _counts[_i] = _split && (_x1 - _x0) * pixel_scale.x > 0.0625 ? 2.0 : 1.0;
+  }}
+  else if (_i + 1u == num_points)
+  {{
+    _counts[_i] = 1.0;
+  }}
+}}
+)";
+
+// After the prefix sum, counts[i] is the number of points up to and including the points of
+// interval i.
+constexpr auto subdivide_shader = R"(#version 430 core
+layout(local_size_x = 256) in;
+layout(std430, binding = 0) readonly buffer xs_block { float xs[]; };
+layout(std430, binding = 1) readonly buffer counts_block { float counts[]; };
+layout(std430, binding = 2) writeonly buffer new_xs_block { float new_xs[]; };
+uniform uint num_points;
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i < num_points)
+  {
+    uint first = i == 0u ? 0u : uint(counts[i - 1u]);
+    new_xs[first] = xs[i];
+    if (uint(counts[i]) - first == 2u)
+    {
+      new_xs[first + 1u] = 0.5 * (xs[i] + xs[i + 1u]);
+    }
+  }
+}
+)";
+
+program_handle refine_program(const expr &e, uint32_t workgroup_size)
+{
+  const auto code = to_glsl({&e, 1});
+  const auto src = fmt::format(refine_shader_fmt, workgroup_size, glsl_definitions({&e, 1}),
+                               code.locals, code.values[0]);
+  return with_user_variables(make_compute_program(src.c_str()), {&e, 1});
+}
+
+// evaluates exprs at the num_points x values in xs
+evaluated_points evaluate_at(std::span<const expr> exprs, gl_id xs, uint32_t num_points,
+                             const evaluation_setting &evaluation)
+{
+  const auto workgroup_size = evaluation.workgroup_size;
+  auto program = compute_program_for_expressions(
+      exprs, "layout(std430, binding = 0) readonly buffer xs_block { float _xs[]; };\n",
+      "float x = _xs[_i];\n", {}, "0.0", workgroup_size);
+  auto result = allocate_points(exprs.size(), num_points);
+  auto bounds = make_bounds_buffer(exprs.size());
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, xs);
+  dispatch_points(program, 0, num_points, workgroup_size,
+                  chunk_points(evaluation, exprs.size() * sizeof(float)));
+  result.bounds = read_bounds(bounds, exprs.size());
+  return result;
+}
+
+// Starts with num_points uniform samples and subdivides the intervals where the curve deviates
+// from its line segments by more than half a pixel, until no interval is subdivided or the graph
+// would have more than sampling.max_points points. Every iteration evaluates the expression,
+// counts the points with prefix_sum and scatters the old and new x values into a new buffer.
+std::tuple<vbo_handle, seq_data_desc>
+adaptive_data_for_expression_2d(mark_type_2d m, const expr &e, uint32_t num_points,
+                                range_setting xrange, range_setting yrange,
+                                const sampling_setting &sampling,
+                                const evaluation_setting &evaluation)
+{
+  const auto workgroup_size = evaluation.workgroup_size;
+  auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
+                          xrange.lower_bound.value_or(-10.0f));
+  auto max_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
+                          xrange.upper_bound.value_or(10.0f));
+  const auto step_x = (max_x - min_x) / static_cast<float>(num_points - 1);
+  auto initial = std::vector<float>(num_points);
+  for (auto i = 0u; i < num_points; ++i)
+  {
+    initial[i] = min_x + static_cast<float>(i) * step_x;
+  }
+  auto vao = make_vao();
+  glBindVertexArray(vao);
+  auto xs = make_vbo();
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, xs);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, num_points * sizeof(float), initial.data(),
+               GL_DYNAMIC_DRAW);
+
+  const auto exprs = exprs_for_function_2d(m, e);
+  // the y range of the screen is the y range of the plot, or that of the initial samples
+  auto [min_y, max_y] = std::pair(-1.0f, 1.0f);
+  if (auto coarse = evaluate_at(exprs, xs, num_points, evaluation); !coarse.bounds.empty())
+  {
+    const auto r = *bounds_rect(coarse.bounds, 2);
+    min_y = r.lower_bounds.y;
+    max_y = r.upper_bounds.y;
+  }
+  auto fixed_bound = [](const range_value &b, float fallback)
+  {
+    return std::visit(overload([](float v) { return v; }, [=](auto_scale) { return fallback; }),
+                      b.value_or(fallback));
+  };
+  min_y = fixed_bound(yrange.lower_bound, min_y);
+  max_y = fixed_bound(yrange.upper_bound, max_y);
+  const auto pixel_scale = glm::vec2(adaptive_screen_size.x / (max_x - min_x),
+                                     adaptive_screen_size.y / (max_y - min_y));
+
+  auto refine = refine_program(e, workgroup_size);
+  auto subdivide = make_compute_program(subdivide_shader);
+  auto counts = make_vbo();
+  auto new_xs = make_vbo();
+  while (num_points < sampling.max_points)
+  {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counts);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, num_points * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, xs);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, counts);
+    glUseProgram(refine);
+    glUniform1ui(glGetUniformLocation(refine, "num_points"), num_points);
+    glUniform2f(glGetUniformLocation(refine, "pixel_scale"), pixel_scale.x, pixel_scale.y);
+    glDispatchCompute((num_points + workgroup_size - 1) / workgroup_size, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    prefix_sum(counts, num_points);
+
+    auto total = 0.0f;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counts);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, (num_points - 1) * sizeof(float), sizeof(float),
+                       &total);
+    const auto next_num_points = static_cast<uint32_t>(total);
+    if (next_num_points == num_points || next_num_points > sampling.max_points)
+    {
+      break;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, new_xs);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, next_num_points * sizeof(float), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, xs);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, counts);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, new_xs);
+    glUseProgram(subdivide);
+    glUniform1ui(glGetUniformLocation(subdivide, "num_points"), num_points);
+    glDispatchCompute((num_points + 255) / 256, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    std::swap(xs, new_xs);
+    num_points = next_num_points;
+  }
+
+  auto [vbo, bounds] = evaluate_at(exprs, xs, num_points, evaluation);
+  auto desc = seq_data_desc(static_cast<uint32_t>(exprs.size()), num_points);
+  desc.bounds = bounds_rect(bounds, 2);
+  return std::make_tuple(std::move(vbo), std::move(desc));
+}
+
+// GLSL has no double versions of the transcendental functions, so functions are evaluated in
+// double precision with the CPU evaluator. The points are stored as floats relative to an origin
+// close to them. They keep their precision even if the x range is tiny compared to its distance
+// from 0. The origin is a float, so that graphs can subtract it from the view exactly. Points are
+// evaluated in chunks, so that the temporary buffers stay within the budget. The y of the origin
+// is the center of the first chunk with finite values.
+std::tuple<vbo_handle, seq_data_desc>
+fp64_data_for_expression_2d(mark_type_2d m, const expr &e, uint32_t num_points,
+                            range_setting xrange, const evaluation_setting &evaluation)
+{
+  auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
+                          xrange.lower_bound.value_or(-10.0f));
+  auto max_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
+                          xrange.upper_bound.value_or(10.0f));
+  const auto step_x = (static_cast<double>(max_x) - static_cast<double>(min_x))
+                      / static_cast<double>(num_points - 1);
+
+  const auto exprs = exprs_for_function_2d(m, e);
+  const auto program = compile(exprs);
+  const auto point_size = exprs.size();
+  const auto max_points = std::min(
+      num_points,
+      chunk_points(evaluation, sizeof(double) + point_size * (sizeof(double) + sizeof(float))));
+  auto xs = std::vector<double>(max_points);
+  auto values = std::vector<double>(point_size * max_points);
+  auto points = std::vector<float>(point_size * max_points);
+  // x is the only variable of function graphs
+  const auto inputs = std::vector<vm_column_fp64>(program.inputs.size(), {xs.data(), 1});
+  auto vbo = make_vbo();
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, point_size * num_points * sizeof(float), nullptr,
+               GL_DYNAMIC_DRAW);
+
+  // x and y alternate in the points
+  auto lower = std::array{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+  auto upper =
+      std::array{std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+  auto origin = std::array{min_x, 0.0f};
+  auto has_origin = false;
+  for (auto offset = 0u; offset < num_points; offset += max_points)
+  {
+    const auto n = std::min(max_points, num_points - offset);
+    for (auto i = 0u; i < n; ++i)
+    {
+      xs[i] = static_cast<double>(min_x) + static_cast<double>(offset + i) * step_x;
+    }
+    const auto chunk = std::span(values).first(point_size * n);
+    evaluate_fp64(program, inputs, offset, n, chunk);
+    for (auto i = 0uz; i < chunk.size(); ++i)
+    {
+      if (std::isfinite(chunk[i]))
+      {
+        lower[i % 2] = std::min(lower[i % 2], chunk[i]);
+        upper[i % 2] = std::max(upper[i % 2], chunk[i]);
+      }
+    }
+    if (!has_origin && lower[1] <= upper[1])
+    {
+      origin[1] = static_cast<float>(0.5 * (lower[1] + upper[1]));
+      has_origin = true;
+    }
+    for (auto i = 0uz; i < chunk.size(); ++i)
+    {
+      points[i] = static_cast<float>(chunk[i] - static_cast<double>(origin[i % 2]));
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset * point_size * sizeof(float)),
+                    static_cast<GLsizeiptr>(chunk.size() * sizeof(float)), points.data());
+  }
+
+  auto desc = seq_data_desc(static_cast<uint32_t>(point_size), num_points);
+  desc.origin = glm::vec2(origin[0], origin[1]);
+  if (has_origin)
+  {
+    desc.bounds = bounding_rect(
+        glm::vec2(static_cast<float>(lower[0]), static_cast<float>(upper[0])),
+        glm::vec2(static_cast<float>(lower[1]), static_cast<float>(upper[1])),
+        glm::vec2(-1.0f, 1.0f));
+  }
+  return std::make_tuple(std::move(vbo), std::move(desc));
+}
+
+std::tuple<vbo_handle, seq_data_desc>
+data_for_parametric_2d(const expr (&exprs)[2], uint32_t num_points, range_setting trange,
+                       const evaluation_setting &evaluation)
 {
   auto min_t = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
                           trange.lower_bound.value_or(-10.0f));
   auto max_t = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
                           trange.upper_bound.value_or(10.0f));
   const auto step_t = (max_t - min_t) / static_cast<float>(num_points - 1);
+  if (evaluation.engine == expression_engine::compute)
+  {
+    const auto variables = std::array{"t"sv};
+    const auto pass = sample_pass{0, num_points, num_points, {{min_t, 0.0f, step_t}}};
+    auto [vbo, bounds] = evaluate_sampled(exprs, variables, {&pass, 1}, evaluation);
+    auto desc = seq_data_desc(2, num_points);
+    desc.bounds = bounds_rect(bounds, 2);
+    return std::make_tuple(std::move(vbo), std::move(desc));
+  }
   auto vao = make_vao();
   auto program = program_for_parametric_data_2d(exprs);
   auto vbo = make_vbo();
@@ -653,18 +1886,16 @@ data_for_parametric_2d(const expr (&exprs)[2], uint32_t num_points, range_settin
   glUseProgram(program);
   glUniform1f(glGetUniformLocation(program, "min_t"), min_t);
   glUniform1f(glGetUniformLocation(program, "step_t"), step_t);
-  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo);
-  glBeginTransformFeedback(GL_POINTS);
-  glDrawArraysInstanced(GL_POINTS, 0, 1, num_points);
-  glEndTransformFeedback();
-  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+  feedback_points(vbo, 0, num_points, sizeof(glm::vec2),
+                  chunk_points(evaluation, sizeof(glm::vec2)));
 
   return std::make_tuple(std::move(vbo), seq_data_desc(2, num_points));
 }
 
 std::tuple<vbo_handle, seq_data_desc>
 data_for_expression_3d(const expr &expr, samples_setting isosamples, samples_setting samples,
-                       range_setting xrange, range_setting yrange)
+                       range_setting xrange, range_setting yrange,
+                       const evaluation_setting &evaluation)
 {
   auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
                           xrange.lower_bound.value_or(-10.0f));
@@ -675,9 +1906,6 @@ data_for_expression_3d(const expr &expr, samples_setting isosamples, samples_set
   auto max_y = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
                           yrange.upper_bound.value_or(10.0f));
   assert(min_x < max_x && min_y < max_y);
-  auto program_x = program_for_functional_data_3d_x(expr);
-  auto program_y = program_for_functional_data_3d_y(expr);
-  glUseProgram(program_x);
   const auto line_step_x = (max_x - min_x) / static_cast<float>(isosamples.x - 1);
   const auto point_step_x = (max_x - min_x) / static_cast<float>(samples.x - 1);
   const auto line_step_y = (max_y - min_y) / static_cast<float>(isosamples.y - 1);
@@ -685,42 +1913,52 @@ data_for_expression_3d(const expr &expr, samples_setting isosamples, samples_set
   const auto num_points_x = isosamples.y * samples.x;
   const auto num_points_y = isosamples.x * samples.y;
   const auto num_points = num_points_x + num_points_y;
+  auto count = std::vector<GLsizei>();
+  count.reserve(isosamples.x + isosamples.y);
+  std::fill_n(std::back_inserter(count), isosamples.y, samples.x);
+  std::fill_n(std::back_inserter(count), isosamples.x, samples.y);
+  if (evaluation.engine == expression_engine::compute)
+  {
+    const auto exprs = std::array<explot::expr, 3>{var("x"), var("y"), expr};
+    const auto variables = std::array{"x"sv, "y"sv};
+    const auto passes = std::array{
+        sample_pass{0, num_points_x, samples.x,
+                    {{min_x, 0.0f, point_step_x}, {min_y, line_step_y, 0.0f}}},
+        sample_pass{num_points_x, num_points_y, samples.y,
+                    {{min_x, line_step_x, 0.0f}, {min_y, 0.0f, point_step_y}}}};
+    auto [vbo, bounds] = evaluate_sampled(exprs, variables, passes, evaluation);
+    auto desc = seq_data_desc(3, std::move(count));
+    desc.bounds = bounds_rect(bounds, 3);
+    return std::make_tuple(std::move(vbo), std::move(desc));
+  }
+  auto program_x = program_for_functional_data_3d_x(expr);
+  auto program_y = program_for_functional_data_3d_y(expr);
+  glUseProgram(program_x);
   auto vao = make_vao();
   auto vbo = make_vbo();
   glBindVertexArray(vao);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
   glBufferData(GL_ARRAY_BUFFER, num_points * sizeof(glm::vec3), nullptr, GL_STATIC_DRAW);
-  glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo, 0, num_points_x * sizeof(glm::vec3));
-  glBeginTransformFeedback(GL_POINTS);
+  const auto max_points = chunk_points(evaluation, sizeof(glm::vec3));
   glUniform1i(glGetUniformLocation(program_x, "num_points_per_line"), samples.x);
   glUniform1f(glGetUniformLocation(program_x, "min_x"), min_x);
   glUniform1f(glGetUniformLocation(program_x, "step_x"), point_step_x);
   glUniform1f(glGetUniformLocation(program_x, "min_y"), min_y);
   glUniform1f(glGetUniformLocation(program_x, "step_y"), line_step_y);
-  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(num_points_x));
-  glEndTransformFeedback();
+  feedback_points(vbo, 0, num_points_x, sizeof(glm::vec3), max_points);
   glUseProgram(program_y);
   glUniform1i(glGetUniformLocation(program_y, "num_points_per_line"), samples.y);
   glUniform1f(glGetUniformLocation(program_y, "min_x"), min_x);
   glUniform1f(glGetUniformLocation(program_y, "step_x"), line_step_x);
   glUniform1f(glGetUniformLocation(program_y, "min_y"), min_y);
   glUniform1f(glGetUniformLocation(program_y, "step_y"), point_step_y);
-  glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo, num_points_x * sizeof(glm::vec3),
-                    num_points_y * sizeof(glm::vec3));
-  glBeginTransformFeedback(GL_POINTS);
-  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(num_points_y));
-  glEndTransformFeedback();
-  auto count = std::vector<GLsizei>();
-  count.reserve(isosamples.x + isosamples.y);
-  std::fill_n(std::back_inserter(count), isosamples.y, samples.x);
-  std::fill_n(std::back_inserter(count), isosamples.x, samples.y);
+  feedback_points(vbo, num_points_x, num_points_y, sizeof(glm::vec3), max_points);
   return std::make_tuple(std::move(vbo), seq_data_desc(3, std::move(count)));
 }
 
-std::tuple<vbo_handle, grid_data_desc> grid_data_for_expression_3d(const expr &expr,
-                                                                   samples_setting samples,
-                                                                   range_setting xrange,
-                                                                   range_setting yrange)
+std::tuple<vbo_handle, grid_data_desc>
+grid_data_for_expression_3d(const expr &expr, samples_setting samples, range_setting xrange,
+                            range_setting yrange, const evaluation_setting &evaluation)
 {
   auto min_x = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
                           xrange.lower_bound.value_or(-10.0f));
@@ -731,31 +1969,40 @@ std::tuple<vbo_handle, grid_data_desc> grid_data_for_expression_3d(const expr &e
   auto max_y = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
                           yrange.upper_bound.value_or(10.0f));
   assert(min_x < max_x && min_y < max_y);
-  auto program = program_for_functional_data_3d_x(expr);
-  glUseProgram(program);
   const auto step_x = (max_x - min_x) / static_cast<float>(samples.x - 1);
   const auto step_y = (max_x - min_x) / static_cast<float>(samples.y - 1);
   const auto num_points = samples.x * samples.y;
+  if (evaluation.engine == expression_engine::compute)
+  {
+    const auto exprs = std::array<explot::expr, 3>{var("x"), var("y"), expr};
+    const auto variables = std::array{"x"sv, "y"sv};
+    const auto pass =
+        sample_pass{0, num_points, samples.x, {{min_x, 0.0f, step_x}, {min_y, step_y, 0.0f}}};
+    auto [vbo, bounds] = evaluate_sampled(exprs, variables, {&pass, 1}, evaluation);
+    return std::make_tuple(std::move(vbo),
+                           grid_data_desc(samples.y, samples.x, 3, bounds_rect(bounds, 3)));
+  }
+  auto program = program_for_functional_data_3d_x(expr);
+  glUseProgram(program);
   auto vao = make_vao();
   auto vbo = make_vbo();
   glBindVertexArray(vao);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
   glBufferData(GL_ARRAY_BUFFER, num_points * sizeof(glm::vec3), nullptr, GL_STATIC_DRAW);
-  glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo, 0, num_points * sizeof(glm::vec3));
-  glBeginTransformFeedback(GL_POINTS);
   glUniform1i(glGetUniformLocation(program, "num_points_per_line"), samples.x);
   glUniform1f(glGetUniformLocation(program, "min_x"), min_x);
   glUniform1f(glGetUniformLocation(program, "step_x"), step_x);
   glUniform1f(glGetUniformLocation(program, "min_y"), min_y);
   glUniform1f(glGetUniformLocation(program, "step_y"), step_y);
-  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(num_points));
-  glEndTransformFeedback();
+  feedback_points(vbo, 0, num_points, sizeof(glm::vec3),
+                  chunk_points(evaluation, sizeof(glm::vec3)));
   return std::make_tuple(std::move(vbo), grid_data_desc(samples.y, samples.x, 3));
 }
 
 std::tuple<vbo_handle, seq_data_desc>
 data_for_parametric_3d(const expr (&exprs)[3], samples_setting isosamples, samples_setting samples,
-                       range_setting u_range, range_setting v_range)
+                       range_setting u_range, range_setting v_range,
+                       const evaluation_setting &evaluation)
 {
   auto min_u = std::visit(overload([](float v) { return v; }, [](auto_scale) { return -10.0f; }),
                           u_range.lower_bound.value_or(-10.0f));
@@ -766,9 +2013,6 @@ data_for_parametric_3d(const expr (&exprs)[3], samples_setting isosamples, sampl
   auto max_v = std::visit(overload([](float v) { return v; }, [](auto_scale) { return 10.0f; }),
                           v_range.upper_bound.value_or(10.0f));
   assert(min_u < max_u && min_v < max_v);
-  auto program_x = program_for_parametric_data_3d_u(exprs);
-  auto program_y = program_for_parametric_data_3d_v(exprs);
-  glUseProgram(program_x);
   const auto line_step_u = (max_u - min_u) / static_cast<float>(isosamples.x - 1);
   const auto point_step_u = (max_u - min_u) / static_cast<float>(samples.x - 1);
   const auto line_step_v = (max_v - min_v) / static_cast<float>(isosamples.y - 1);
@@ -776,35 +2020,45 @@ data_for_parametric_3d(const expr (&exprs)[3], samples_setting isosamples, sampl
   const auto num_points_u = isosamples.y * samples.x;
   const auto num_points_v = isosamples.x * samples.y;
   const auto num_points = num_points_u + num_points_v;
+  auto count = std::vector<GLsizei>();
+  count.reserve(isosamples.x + isosamples.y);
+  std::fill_n(std::back_inserter(count), isosamples.y, samples.x);
+  std::fill_n(std::back_inserter(count), isosamples.x, samples.y);
+  if (evaluation.engine == expression_engine::compute)
+  {
+    const auto variables = std::array{"u"sv, "v"sv};
+    const auto passes = std::array{
+        sample_pass{0, num_points_u, samples.x,
+                    {{min_u, 0.0f, point_step_u}, {min_v, line_step_v, 0.0f}}},
+        sample_pass{num_points_u, num_points_v, samples.y,
+                    {{min_u, line_step_u, 0.0f}, {min_v, 0.0f, point_step_v}}}};
+    auto [vbo, bounds] = evaluate_sampled(exprs, variables, passes, evaluation);
+    auto desc = seq_data_desc(3, std::move(count));
+    desc.bounds = bounds_rect(bounds, 3);
+    return std::make_tuple(std::move(vbo), std::move(desc));
+  }
+  auto program_x = program_for_parametric_data_3d_u(exprs);
+  auto program_y = program_for_parametric_data_3d_v(exprs);
+  glUseProgram(program_x);
   auto vao = make_vao();
   auto vbo = make_vbo();
   glBindVertexArray(vao);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
   glBufferData(GL_ARRAY_BUFFER, num_points * sizeof(glm::vec3), nullptr, GL_STATIC_DRAW);
-  glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo, 0, num_points_u * sizeof(glm::vec3));
-  glBeginTransformFeedback(GL_POINTS);
+  const auto max_points = chunk_points(evaluation, sizeof(glm::vec3));
   glUniform1i(glGetUniformLocation(program_x, "num_points_per_line"), samples.x);
   glUniform1f(glGetUniformLocation(program_x, "min_u"), min_u);
   glUniform1f(glGetUniformLocation(program_x, "step_u"), point_step_u);
   glUniform1f(glGetUniformLocation(program_x, "min_v"), min_v);
   glUniform1f(glGetUniformLocation(program_x, "step_v"), line_step_v);
-  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(num_points_u));
-  glEndTransformFeedback();
+  feedback_points(vbo, 0, num_points_u, sizeof(glm::vec3), max_points);
   glUseProgram(program_y);
   glUniform1i(glGetUniformLocation(program_y, "num_points_per_line"), samples.y);
   glUniform1f(glGetUniformLocation(program_y, "min_u"), min_u);
   glUniform1f(glGetUniformLocation(program_y, "step_u"), line_step_u);
   glUniform1f(glGetUniformLocation(program_y, "min_v"), min_v);
   glUniform1f(glGetUniformLocation(program_y, "step_v"), point_step_v);
-  glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo, num_points_u * sizeof(glm::vec3),
-                    num_points_v * sizeof(glm::vec3));
-  glBeginTransformFeedback(GL_POINTS);
-  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(num_points_v));
-  glEndTransformFeedback();
-  auto count = std::vector<GLsizei>();
-  count.reserve(isosamples.x + isosamples.y);
-  std::fill_n(std::back_inserter(count), isosamples.y, samples.x);
-  std::fill_n(std::back_inserter(count), isosamples.x, samples.y);
+  feedback_points(vbo, num_points_u, num_points_v, sizeof(glm::vec3), max_points);
   return std::make_tuple(std::move(vbo), seq_data_desc(3, std::move(count)));
 }
 
@@ -886,17 +2140,207 @@ draw_info surface_draw_info(const grid_data_desc &d)
   return draw_info(std::move(ebo), std::move(count));
 }
 
-draw_info::draw_info(vbo_handle indices, std::vector<GLsizei> c)
-    : ebo(std::move(indices)), num_indices(std::ranges::fold_left(c, 0u, std::plus<>{})),
-      count(std::move(c))
+draw_info::draw_info(vbo_handle indices, std::vector<GLsizei> c) : ebo(std::move(indices))
+{
+  set_count(*this, std::move(c));
+}
+
+void set_count(draw_info &info, std::vector<GLsizei> count)
 {
-  auto start = intptr_t(0);
-  starts.reserve(count.size());
+  auto first = std::vector<GLsizei>();
+  first.reserve(count.size());
+  auto start = GLsizei(0);
   for (auto c : count)
   {
-    starts.push_back(start);
-    start += c * static_cast<intptr_t>(sizeof(GLuint));
+    first.push_back(start);
+    start += c;
+  }
+  set_ranges(info, std::move(count), first);
+}
+
+void set_ranges(draw_info &info, std::vector<GLsizei> count, std::span<const GLsizei> first)
+{
+  assert(count.size() == first.size());
+  info.num_indices = std::ranges::fold_left(count, 0u, std::plus<>{});
+  info.count = std::move(count);
+  info.starts.clear();
+  info.starts.reserve(first.size());
+  for (auto f : first)
+  {
+    info.starts.push_back(f * static_cast<intptr_t>(sizeof(GLuint)));
+  }
+}
+
+live_buffer make_live_buffer(std::span<const expr> exprs, std::optional<uint32_t> window)
+{
+  auto indices = extract_indices(exprs);
+  // records are counted by their fields, so at least one column has to be read
+  if (indices.empty())
+  {
+    indices.push_back(1);
+  }
+  auto program = program_for_using_expressions(exprs, indices);
+  auto vao = make_vao();
+  auto rows = make_vbo();
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, rows);
+  const auto num_indices = static_cast<GLsizei>(indices.size());
+  for (auto i = 0U; i < indices.size(); ++i)
+  {
+    glEnableVertexAttribArray(i);
+    glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, num_indices * static_cast<GLsizei>(sizeof(float)),
+                          (void *)(i * sizeof(float)));
+  }
+  return live_buffer{.indices = std::move(indices),
+                     .point_size = static_cast<uint32_t>(exprs.size()),
+                     .window = window,
+                     .program = std::move(program),
+                     .vao = std::move(vao),
+                     .rows = std::move(rows),
+                     .x_program = window ? compile(exprs.first(1)) : vm_program(),
+                     .xs = {}};
+}
+
+// evaluates the x of rows, which are stored from the head of the ring on, into xs
+void append_xs(live_buffer &buffer, std::span<const float> rows, uint32_t num_rows)
+{
+  const auto row_size = buffer.indices.size();
+  auto columns = std::vector<vm_column>();
+  for (const auto &in : buffer.x_program.inputs)
+  {
+    const auto column = std::ranges::find(buffer.indices, std::get<data_ref>(in).idx);
+    assert(column != buffer.indices.end());
+    columns.push_back(vm_column{rows.data() + (column - buffer.indices.begin()), row_size});
+  }
+  auto xs = std::vector<float>(num_rows);
+  evaluate(buffer.x_program, columns, static_cast<uint32_t>(buffer.num_rows), num_rows, xs);
+  buffer.xs.resize(buffer.capacity);
+  const auto n = std::min(num_rows, buffer.capacity - buffer.head);
+  std::ranges::copy(std::span(xs).first(n), buffer.xs.begin() + buffer.head);
+  std::ranges::copy(std::span(xs).subspan(n), buffer.xs.begin());
+}
+
+// the capacity of live buffers without a window, so that their points can be drawn in one call
+constexpr auto max_live_rows = uint64_t{std::numeric_limits<GLsizei>::max() - 1};
+
+std::optional<vbo_handle> append(live_buffer &buffer, gl_id vbo, std::span<const float> rows)
+{
+  const auto row_size = buffer.indices.size();
+  assert(rows.size() % row_size == 0);
+  auto num_rows = static_cast<uint32_t>(rows.size() / row_size);
+  const auto point_bytes = buffer.point_size * sizeof(float);
+
+  auto grown = std::optional<vbo_handle>();
+  if (buffer.window)
+  {
+    if (buffer.capacity == 0)
+    {
+      buffer.capacity = *buffer.window;
+      grown = make_vbo();
+      glBindBuffer(GL_ARRAY_BUFFER, *grown);
+      glBufferData(GL_ARRAY_BUFFER, (buffer.capacity + 1) * point_bytes, nullptr, GL_DYNAMIC_DRAW);
+      vbo = *grown;
+    }
+    // rows that would be overwritten by the same call are skipped
+    if (num_rows > buffer.capacity)
+    {
+      const auto skipped = num_rows - buffer.capacity;
+      rows = rows.subspan(skipped * row_size);
+      buffer.num_rows += skipped;
+      buffer.head = (buffer.head + skipped) % buffer.capacity;
+      num_rows = buffer.capacity;
+    }
+  }
+  else if (buffer.num_rows + num_rows > buffer.capacity)
+  {
+    // without a window, all rows are kept up to max_live_rows and later rows are dropped, so
+    // the number of stored rows fits the buffer
+    const auto stored = buffer.num_rows;
+    num_rows = static_cast<uint32_t>(std::min(uint64_t{num_rows}, max_live_rows - stored));
+    rows = rows.first(num_rows * row_size);
+    const auto capacity = std::clamp(2 * (stored + num_rows), uint64_t{1024}, max_live_rows);
+    if (capacity > buffer.capacity)
+    {
+      grown = make_vbo();
+      glBindBuffer(GL_COPY_WRITE_BUFFER, *grown);
+      glBufferData(GL_COPY_WRITE_BUFFER, (capacity + 1) * point_bytes, nullptr, GL_DYNAMIC_DRAW);
+      if (stored > 0)
+      {
+        glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, stored * point_bytes);
+      }
+      buffer.capacity = static_cast<uint32_t>(capacity);
+      buffer.head = static_cast<uint32_t>(stored);
+      vbo = *grown;
+    }
+  }
+  if (num_rows == 0)
+  {
+    return grown;
+  }
+
+  glBindVertexArray(buffer.vao);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer.rows);
+  if (rows.size() > buffer.rows_size)
+  {
+    buffer.rows_size = rows.size();
+    glBufferData(GL_ARRAY_BUFFER, rows.size() * sizeof(float), rows.data(), GL_STREAM_DRAW);
+  }
+  else
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, rows.size() * sizeof(float), rows.data());
+  }
+  if (buffer.window)
+  {
+    append_xs(buffer, rows, num_rows);
+  }
+  glUseProgram(buffer.program);
+  glUniform1f(glGetUniformLocation(buffer.program, "row_offset"),
+              static_cast<float>(buffer.num_rows));
+
+  // the rows are written in two parts, if they wrap around the end of the ring
+  auto wrote_first_point = false;
+  for (auto written = 0u; written < num_rows;)
+  {
+    const auto point = buffer.head;
+    const auto n = std::min(num_rows - written, buffer.capacity - point);
+    glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo, point * point_bytes, n * point_bytes);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, static_cast<GLint>(written), static_cast<GLsizei>(n));
+    glEndTransformFeedback();
+    wrote_first_point = wrote_first_point || point == 0;
+    written += n;
+    buffer.head = (point + n) % buffer.capacity;
+  }
+  if (buffer.window && wrote_first_point)
+  {
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_READ_BUFFER, 0,
+                        buffer.capacity * point_bytes, point_bytes);
+  }
+  buffer.num_rows += num_rows;
+  return grown;
+}
+
+uint32_t first_point(const live_buffer &buffer)
+{
+  return buffer.num_rows > buffer.capacity ? buffer.head : 0u;
+}
+
+uint32_t size(const live_buffer &buffer)
+{
+  return static_cast<uint32_t>(std::min<uint64_t>(buffer.num_rows, buffer.capacity));
+}
+
+glm::vec2 window_x_range(const live_buffer &buffer)
+{
+  auto result =
+      glm::vec2(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+  for (auto x : std::span(buffer.xs).first(size(buffer)))
+  {
+    result = glm::vec2(std::min(result.x, x), std::max(result.y, x));
   }
+  return result;
 }
 
 std::tuple<vbo_handle, seq_data_desc> data_for_span(std::span<const float> data,
@@ -946,87 +2390,178 @@ seq_data_desc::seq_data_desc(uint32_t point_size, std::vector<GLsizei> count)
 {
 }
 
-std::tuple<std::vector<std::tuple<vbo_handle, seq_data_desc>>, time_point>
+std::tuple<std::vector<std::tuple<shared_vbo_handle, seq_data_desc>>, time_point>
 data_for_plot(const plot_command_2d &plot)
 {
-  auto [row_data, timebase] = row_data_for_graphs(plot.graphs, plot.separator);
-  auto result = std::vector<std::tuple<vbo_handle, seq_data_desc>>();
+  auto cached =
+      find_cached_graphs(std::span(plot.graphs), plot.separator, plot.datafile_cache);
+  auto [row_data, timebase] =
+      row_data_for_graphs(plot.graphs, plot.separator, plot.engine, cached);
+  cached.timebase = timebase;
+
+  auto functions = std::vector<std::pair<mark_type_2d, const expr *>>();
+  for (const auto &g : plot.graphs)
+  {
+    if (const auto *e = std::get_if<expr>(&g.data))
+    {
+      functions.emplace_back(g.mark, e);
+    }
+  }
+  auto function_data = data_for_functions_2d(plot, functions, plot.samples.x, plot.x_range);
+  auto next_function = function_data.begin();
+
+  using graph_data = std::tuple<shared_vbo_handle, seq_data_desc>;
+  auto result = std::vector<graph_data>();
   result.reserve(plot.graphs.size());
+  auto next_graph = 0uz;
   std::ranges::copy(
       std::ranges::views::transform(
           plot.graphs,
           [&](const graph_desc_2d &g)
           {
+            const auto graph = next_graph++;
             return std::visit(
                 overload(
-                    [&](const expr &expr)
-                    { return data_for_expression_2d(g.mark, expr, plot.samples.x, plot.x_range); },
-                    [&](const csv_data &c)
+                    [&](const expr &) -> graph_data { return std::move(*next_function++); },
+                    [&](const csv_data &c) -> graph_data
                     {
-                      auto &rd = *std::ranges::find_if(row_data, [&](const struct row_data &r)
-                                                       { return r.filename == c.path; });
-                      auto vbo = data_for_using_expressions(c.expressions, rd);
-                      return std::make_tuple(std::move(vbo), seq_data_desc(2, rd.num_points));
+                      auto find_rows = [&]() -> struct row_data &
+                      {
+                        return *std::ranges::find_if(row_data, [&](const struct row_data &r)
+                                                     { return r.filename == c.path; });
+                      };
+                      auto points =
+                          points_for_csv(c, graph, cached, find_rows, plot.evaluation);
+                      auto desc = seq_data_desc(2, points.num_points);
+                      desc.bounds = bounds_rect(points.bounds, 2);
+                      return std::make_tuple(std::move(points.vbo), std::move(desc));
                     },
-                    [&](const parametric_data_2d &c)
+                    [&](const parametric_data_2d &c) -> graph_data
                     {
-                      return data_for_parametric_2d(c.expressions, plot.samples.x, plot.t_range);
+                      return data_for_parametric_2d(c.expressions, plot.samples.x, plot.t_range,
+                                                    plot.evaluation);
+                    },
+                    [&](const live_data &) -> graph_data
+                    {
+                      // filled by the plot as rows arrive
+                      return std::make_tuple(make_vbo(), seq_data_desc(2, 0));
                     }),
                 g.data);
           }),
       std::back_inserter(result));
-  return std::make_tuple(std::move(result), timebase);
+  return std::make_tuple(std::move(result), timebase.value_or(time_point()));
+}
+
+std::tuple<vbo_handle, seq_data_desc> data_for_function_2d(const plot_command_2d &plot,
+                                                           mark_type_2d m, const expr &e,
+                                                           uint32_t num_points,
+                                                           range_setting xrange)
+{
+  if (plot.precision == precision_setting::fp64)
+  {
+    return fp64_data_for_expression_2d(m, e, num_points, xrange, plot.evaluation);
+  }
+  if (plot.sampling.adaptive)
+  {
+    return adaptive_data_for_expression_2d(m, e, num_points, xrange, plot.y_range, plot.sampling,
+                                           plot.evaluation);
+  }
+  return data_for_expression_2d(m, e, num_points, xrange, plot.evaluation);
 }
 
-std::vector<std::tuple<vbo_handle, data_desc>> data_for_plot(const plot_command_3d &plot)
+std::vector<std::tuple<vbo_handle, seq_data_desc>>
+data_for_functions_2d(const plot_command_2d &plot,
+                      std::span<const std::pair<mark_type_2d, const expr *>> graphs,
+                      uint32_t num_points, range_setting xrange)
 {
-  auto [row_data, time_base] = row_data_for_graphs(plot.graphs, plot.separator);
-  auto result = std::vector<std::tuple<vbo_handle, data_desc>>();
+  // adaptive sampling chooses different x values for every graph
+  if (graphs.size() > 1 && !plot.sampling.adaptive && plot.precision == precision_setting::single)
+  {
+    return data_for_expressions_2d(graphs, num_points, xrange, plot.evaluation);
+  }
+  auto result = std::vector<std::tuple<vbo_handle, seq_data_desc>>();
+  result.reserve(graphs.size());
+  for (const auto &[m, e] : graphs)
+  {
+    result.push_back(data_for_function_2d(plot, m, *e, num_points, xrange));
+  }
+  return result;
+}
+
+bool update_function_2d(gl_id vbo, const plot_command_2d &plot, mark_type_2d m, const expr &e,
+                        uint32_t num_points, range_setting xrange)
+{
+  if (plot.precision == precision_setting::fp64 || plot.sampling.adaptive)
+  {
+    return false;
+  }
+  update_expression_2d(vbo, m, e, num_points, xrange, plot.evaluation);
+  return true;
+}
+
+std::vector<std::tuple<shared_vbo_handle, data_desc>> data_for_plot(const plot_command_3d &plot)
+{
+  auto cached =
+      find_cached_graphs(std::span(plot.graphs), plot.separator, plot.datafile_cache);
+  auto [row_data, timebase] =
+      row_data_for_graphs(plot.graphs, plot.separator, plot.engine, cached);
+  cached.timebase = timebase;
+  using graph_data = std::tuple<shared_vbo_handle, data_desc>;
+  auto result = std::vector<graph_data>();
   result.reserve(plot.graphs.size());
+  auto next_graph = 0uz;
   std::ranges::copy(
       std::ranges::views::transform(
           plot.graphs,
           [&](const graph_desc_3d &g)
           {
+            const auto graph = next_graph++;
             return std::visit(
                 overload(
-                    [&](const expr &expr) -> std::tuple<vbo_handle, data_desc>
+                    [&](const expr &expr) -> graph_data
                     {
                       if (g.mark == mark_type_3d::surface || g.mark == mark_type_3d::pm3d)
                       {
                         return grid_data_for_expression_3d(expr, plot.samples, plot.x_range,
-                                                           plot.y_range);
+                                                           plot.y_range, plot.evaluation);
                       }
                       else
                       {
                         return data_for_expression_3d(expr, plot.isosamples, plot.samples,
-                                                      plot.x_range, plot.y_range);
+                                                      plot.x_range, plot.y_range,
+                                                      plot.evaluation);
                       }
                     },
-                    [&](const csv_data &c) -> std::tuple<vbo_handle, data_desc>
+                    [&](const csv_data &c) -> graph_data
                     {
-                      auto &rd = *std::ranges::find_if(
-                          row_data, [&](const struct row_data &r)
-                          { return r.filename == c.path && r.columns.has_value() == c.matrix; });
-                      auto vbo = data_for_using_expressions(c.expressions, rd);
-                      if (rd.columns.has_value()
+                      auto find_rows = [&]() -> struct row_data &
+                      {
+                        return *std::ranges::find_if(
+                            row_data, [&](const struct row_data &r)
+                            { return r.filename == c.path && r.columns.has_value() == c.matrix; });
+                      };
+                      auto p = points_for_csv(c, graph, cached, find_rows, plot.evaluation);
+                      if (p.columns.has_value()
                           && (g.mark == mark_type_3d::lines || g.mark == mark_type_3d::surface
                               || g.mark == mark_type_3d::pm3d))
                       {
                         return std::make_tuple(
-                            std::move(vbo),
-                            grid_data_desc(rd.num_points / *rd.columns, *rd.columns,
-                                           static_cast<uint32_t>(c.expressions.size())));
+                            std::move(p.vbo),
+                            grid_data_desc(p.num_points / *p.columns, *p.columns,
+                                           static_cast<uint32_t>(c.expressions.size()),
+                                           bounds_rect(p.bounds, 3)));
                       }
                       else
                       {
-                        return std::make_tuple(std::move(vbo), seq_data_desc(3, rd.num_points));
+                        auto desc = seq_data_desc(3, p.num_points);
+                        desc.bounds = bounds_rect(p.bounds, 3);
+                        return std::make_tuple(std::move(p.vbo), data_desc(std::move(desc)));
                       }
                     },
-                    [&](const parametric_data_3d &c) -> std::tuple<vbo_handle, data_desc>
+                    [&](const parametric_data_3d &c) -> graph_data
                     {
                       return data_for_parametric_3d(c.expressions, plot.isosamples, plot.samples,
-                                                    plot.u_range, plot.v_range);
+                                                    plot.u_range, plot.v_range, plot.evaluation);
                     }),
                 g.data);
           }),
@@ -1041,15 +2576,19 @@ seq_data_desc reshape(seq_data_desc d, uint32_t new_point_size)
     assert(new_point_size % d.point_size == 0);
     const auto factor = new_point_size / d.point_size;
     assert(d.num_points % factor == 0);
-    return seq_data_desc(new_point_size, d.num_points / factor,
-                         static_cast<uint32_t>(d.count.size()));
+    auto result = seq_data_desc(new_point_size, d.num_points / factor,
+                                static_cast<uint32_t>(d.count.size()));
+    result.bounds = d.bounds;
+    return result;
   }
   else
   {
     assert(d.point_size % new_point_size == 0);
     const auto factor = d.point_size / new_point_size;
-    return seq_data_desc(new_point_size, d.num_points * factor,
-                         static_cast<uint32_t>(d.count.size()));
+    auto result = seq_data_desc(new_point_size, d.num_points * factor,
+                                static_cast<uint32_t>(d.count.size()));
+    result.bounds = d.bounds;
+    return result;
   }
 }
 
@@ -1,13 +1,17 @@
 #pragma once
 #include "gl-handle.hpp"
 #include <cstdint>
+#include <optional>
 #include <span>
 #include <glm/vec3.hpp>
 #include "commands.hpp"
 #include <tuple>
+#include <utility>
 #include <variant>
 #include <vector>
 #include "csv.hpp"
+#include "expr_vm.hpp"
+#include "rect.hpp"
 
 namespace explot
 {
@@ -16,6 +20,10 @@ struct seq_data_desc
   uint32_t num_points;
   uint32_t point_size;
   std::vector<GLsizei> count;
+  // bounds of the points, if they were computed with the points
+  std::optional<rect> bounds;
+  // the points are stored relative to origin
+  glm::vec2 origin = glm::vec2(0.0f);
 
   seq_data_desc() = default;
   seq_data_desc(uint32_t point_size, uint32_t num_points, uint32_t num_segments = 1);
@@ -27,6 +35,7 @@ struct grid_data_desc
   uint32_t num_rows;
   uint32_t num_columns;
   uint32_t point_size;
+  std::optional<rect> bounds = std::nullopt;
 };
 
 using data_desc = std::variant<seq_data_desc, grid_data_desc>;
@@ -42,10 +51,70 @@ struct draw_info
   std::vector<intptr_t> starts;
 };
 
-std::tuple<std::vector<std::tuple<vbo_handle, seq_data_desc>>, time_point>
+void set_count(draw_info &info, std::vector<GLsizei> count);
+// first is the index of the first element of each range in the ebo
+void set_ranges(draw_info &info, std::vector<GLsizei> count, std::span<const GLsizei> first);
+
+// Evaluates the using expressions of a live graph for rows as they arrive and writes the points
+// to the vbo of the graph. With a window, the vbo is a ring of window points, which overwrites the
+// oldest points. Point capacity is a copy of point 0, so that a line strip across the end of the
+// ring can be drawn in two ranges. Without a window, the vbo grows as needed.
+struct live_buffer
+{
+  std::vector<int> indices;
+  uint32_t point_size;
+  std::optional<uint32_t> window;
+  // number of rows received so far, whose row number is $0
+  uint64_t num_rows = 0;
+  uint32_t capacity = 0;
+  // the point, where the next row is written, modulo capacity
+  uint32_t head = 0;
+  program_handle program;
+  vao_handle vao;
+  vbo_handle rows;
+  std::size_t rows_size = 0;
+  // with a window, the x of the points are also evaluated on the CPU into the ring xs, so that the
+  // view can follow them without reading the points back
+  vm_program x_program;
+  std::vector<float> xs;
+};
+
+live_buffer make_live_buffer(std::span<const expr> exprs, std::optional<uint32_t> window);
+
+// Returns a new vbo with the contents of vbo, if it was too small for the new rows.
+std::optional<vbo_handle> append(live_buffer &buffer, gl_id vbo, std::span<const float> rows);
+
+// The points of the buffer are [first, first + size) modulo capacity.
+uint32_t first_point(const live_buffer &buffer);
+uint32_t size(const live_buffer &buffer);
+
+// (min, max) of the x of the points of a buffer with a window, ignoring NaN
+glm::vec2 window_x_range(const live_buffer &buffer);
+
+// The points of datafiles are shared with a cache, so that plotting them again does not read the
+// files again.
+std::tuple<std::vector<std::tuple<shared_vbo_handle, seq_data_desc>>, time_point>
 data_for_plot(const plot_command_2d &plot);
 
-std::vector<std::tuple<vbo_handle, data_desc>> data_for_plot(const plot_command_3d &plot);
+std::vector<std::tuple<shared_vbo_handle, data_desc>> data_for_plot(const plot_command_3d &plot);
+
+// Evaluates the function e of a graph of plot with num_points samples of xrange, like
+// data_for_plot does with the samples and x range of plot.
+std::tuple<vbo_handle, seq_data_desc> data_for_function_2d(const plot_command_2d &plot,
+                                                           mark_type_2d m, const expr &e,
+                                                           uint32_t num_points,
+                                                           range_setting xrange);
+// Evaluates the functions of graphs like data_for_function_2d, all in one dispatch, if they can
+// share the samples of x.
+std::vector<std::tuple<vbo_handle, seq_data_desc>>
+data_for_functions_2d(const plot_command_2d &plot,
+                      std::span<const std::pair<mark_type_2d, const expr *>> graphs,
+                      uint32_t num_points, range_setting xrange);
+// Evaluates e again into vbo, which holds the points of data_for_function_2d with the same
+// arguments, e.g. after a variable changed. The bounds of the points are not updated. Returns false
+// for adaptive sampling and double precision, whose points have to be created again.
+bool update_function_2d(gl_id vbo, const plot_command_2d &plot, mark_type_2d m, const expr &e,
+                        uint32_t num_points, range_setting xrange);
 
 std::tuple<vbo_handle, seq_data_desc> data_for_span(std::span<const float> data,
                                                     uint32_t point_size);
@@ -24,6 +24,7 @@
 #include "user_definitions.hpp"
 #include "layout.hpp"
 #include "font_atlas.hpp"
+#include "program.hpp"
 #include <fstream>
 #include <algorithm>
 #include <cctype>
@@ -131,6 +132,7 @@ static constexpr auto uimain = [](auto commands)
     // glViewport(0, 0, width, height);
     screen_space_out.on_next(rect{.lower_bounds = {0, 0, -1}, .upper_bounds = {width, height, 1}});
 
+    advance_animations(std::chrono::steady_clock::now());
     frames_out.on_next(unit{});
 
     while (!rl.empty() && rl.peek().when < rl.now())
@@ -144,6 +146,7 @@ static constexpr auto uimain = [](auto commands)
 
   lifetime.unsubscribe();
 
+  clear_program_cache();
   glfwDestroyWindow(window);
   glfwTerminate();
 
@@ -187,6 +190,14 @@ std::expected<bool, std::string> handle_line(std::string_view line,
         {
           add_definition(std::get<user_definition>(std::move(cmd)));
         }
+        else if (std::holds_alternative<bind_command>(cmd))
+        {
+          bind_variable(std::get<bind_command>(cmd));
+        }
+        else if (std::holds_alternative<animate_command>(cmd))
+        {
+          animate_variable(std::get<animate_command>(cmd));
+        }
         else if (std::holds_alternative<cd_command>(cmd))
         {
           std::filesystem::current_path(std::get<cd_command>(cmd).path);
@@ -340,6 +351,7 @@ int main()
   const auto history_path = data_dir / "history";
   std::filesystem::create_directories(data_dir);
   setup_history(history_path);
+  set_program_cache_dir(data_dir / "shader-cache");
   auto uithread = std::optional<std::jthread>();
 
   for (auto line_ptr = std::unique_ptr<char>(readnextline("> ")); line_ptr != nullptr;
@@ -0,0 +1,79 @@
+#include "expr.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace explot
+{
+expr::expr(literal_expr l) { add_literal(l.value); }
+
+expr::expr(data_ref d)
+{
+  assert(d.idx >= 0);
+  add(expr_op::column, {}, static_cast<uint32_t>(d.idx));
+}
+
+expr::expr(const var &v) { add(expr_op::variable, {}, add_name(v.name)); }
+
+expr::expr(user_var_ref ref) { add(expr_op::user_variable, {}, ref.idx); }
+
+uint32_t expr::add(expr_op op, std::span<const uint32_t> node_args, uint32_t idx, double value)
+{
+  assert(std::ranges::all_of(node_args, [&](uint32_t a) { return a < nodes.size(); }));
+  nodes.push_back(expr_node{.op = op,
+                            .value = value,
+                            .idx = idx,
+                            .first_arg = static_cast<uint32_t>(args.size()),
+                            .num_args = static_cast<uint32_t>(node_args.size())});
+  args.insert(args.end(), node_args.begin(), node_args.end());
+  return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+uint32_t expr::add_name(std::string_view name)
+{
+  auto it = std::ranges::find(names, name);
+  if (it == names.end())
+  {
+    names.emplace_back(name);
+    return static_cast<uint32_t>(names.size() - 1);
+  }
+  return static_cast<uint32_t>(std::distance(names.begin(), it));
+}
+
+uint32_t expr::append(const expr &e, uint32_t node)
+{
+  assert(&e != this && node < e.nodes.size());
+  // the arguments come first, so walking backwards finds every node that node uses
+  auto used = std::vector<bool>(node + 1uz);
+  used[node] = true;
+  for (auto i = node + 1; i-- > 0;)
+  {
+    if (used[i])
+    {
+      for (auto a : e.args_of(e.nodes[i]))
+      {
+        used[a] = true;
+      }
+    }
+  }
+
+  auto copies = std::vector<uint32_t>(node + 1uz);
+  auto copied_args = std::vector<uint32_t>();
+  for (auto i = 0u; i <= node; ++i)
+  {
+    if (!used[i])
+    {
+      continue;
+    }
+    const auto &n = e.nodes[i];
+    copied_args.clear();
+    for (auto a : e.args_of(n))
+    {
+      copied_args.push_back(copies[a]);
+    }
+    const auto has_name = n.op == expr_op::variable || n.op == expr_op::unary_call
+                          || n.op == expr_op::binary_call;
+    copies[i] = add(n.op, copied_args, has_name ? add_name(e.name_of(n)) : n.idx, n.value);
+  }
+  return copies[node];
+}
+} // namespace explot
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace explot
+{
+struct literal_expr final
+{
+  double value;
+};
+
+struct data_ref
+{
+  int idx;
+};
+
+struct var
+{
+  std::string name;
+};
+
+struct user_var_ref
+{
+  uint32_t idx;
+};
+
+enum class expr_op : uint8_t
+{
+  literal,
+  variable,
+  column,
+  user_variable,
+  neg,
+  add,
+  sub,
+  mul,
+  div,
+  // comparisons and logical operators are 1 if true and 0 if false
+  less,
+  less_equal,
+  greater,
+  greater_equal,
+  equal,
+  not_equal,
+  logical_and,
+  logical_or,
+  logical_not,
+  // the second argument if the first is not 0 and the third otherwise
+  select,
+  unary_call,
+  binary_call,
+  user_call
+};
+
+// the value of a comparison or a logical operator
+template <typename T>
+constexpr T truth(bool b)
+{
+  return b ? T(1) : T(0);
+}
+
+struct expr_node
+{
+  expr_op op;
+  // the value of a literal in double precision, which the engines in single precision round
+  double value = 0.0;
+  // the column, the user definition or the index of the name of a variable or builtin in names
+  uint32_t idx = 0;
+  // the arguments are args[first_arg] to args[first_arg + num_args - 1] of the expression
+  uint32_t first_arg = 0;
+  uint32_t num_args = 0;
+};
+
+// An expression stored flat in a few vectors instead of a tree of nodes on the heap. Arguments
+// are indices of nodes, which come before the nodes using them, so most algorithms are a loop over
+// the nodes. The root is the last node. Every node is used by the root and a node can be the
+// argument of several nodes, like x in x*x.
+struct expr
+{
+  std::vector<expr_node> nodes;
+  std::vector<uint32_t> args;
+  std::vector<std::string> names;
+
+  expr() = default;
+  expr(literal_expr l);
+  expr(data_ref d);
+  expr(const var &v);
+  expr(user_var_ref ref);
+
+  uint32_t root() const { return static_cast<uint32_t>(nodes.size() - 1); }
+  std::span<const uint32_t> args_of(const expr_node &n) const
+  {
+    return std::span(args).subspan(n.first_arg, n.num_args);
+  }
+  const std::string &name_of(const expr_node &n) const { return names[n.idx]; }
+
+  // appends a node and returns its index. The arguments must be nodes of this expression.
+  uint32_t add(expr_op op, std::span<const uint32_t> node_args = {}, uint32_t idx = 0,
+               double value = 0.0);
+  uint32_t add_literal(double value) { return add(expr_op::literal, {}, 0, value); }
+  // returns the index of name in names, which is added if it is not there yet
+  uint32_t add_name(std::string_view name);
+  // Appends the nodes of e, which node uses, and returns the index of the copy of node. Appending
+  // the root of an expression to an empty one drops the nodes, which the root does not use.
+  uint32_t append(const expr &e, uint32_t node);
+};
+} // namespace explot
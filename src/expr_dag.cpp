@@ -0,0 +1,284 @@
+#include "expr_dag.hpp"
+#include "parse_ast.hpp"
+#include "simplify.hpp"
+#include "user_definitions.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <map>
+#include <tuple>
+
+namespace
+{
+using namespace explot;
+
+// using ordered map, because there is no std::hash for tuple. Literals are compared by their bits,
+// because NaN is not ordered.
+using node_key = std::tuple<dag_op, uint64_t, std::string, uint32_t, std::vector<uint32_t>>;
+
+// functions with at most this many nodes in their body are inlined
+constexpr auto max_inlined_size = 8uz;
+
+// Whether e uses variables other than params or columns, also through user definitions. A
+// variable, which is not constant, uses them.
+bool uses_inputs(const expr &e, std::span<const std::string> params)
+{
+  return std::ranges::any_of(
+      e.nodes,
+      [&](const expr_node &n)
+      {
+        switch (n.op)
+        {
+        case expr_op::variable:
+          return std::ranges::find(params, e.name_of(n)) == params.end();
+        case expr_op::column:
+          return true;
+        case expr_op::user_variable:
+          return !constant_value(n.idx).has_value();
+        case expr_op::user_call:
+        {
+          const auto &def = get_definition(n.idx);
+          return uses_inputs(def.body, *def.params);
+        }
+        default:
+          return false;
+        }
+      });
+}
+
+struct dag_builder
+{
+  expr_dag &dag;
+  std::map<node_key, uint32_t> &known;
+  user_inlining inlining;
+  // the argument nodes of an inlined user function
+  std::vector<std::pair<std::string, uint32_t>> params;
+
+  std::optional<double> literal(uint32_t node) const
+  {
+    const auto &n = dag.nodes[node];
+    return n.op == dag_op::literal ? std::optional(n.value) : std::nullopt;
+  }
+
+  // like simplify, which can not see the arguments of inlined functions
+  std::optional<uint32_t> fold(const dag_node &n)
+  {
+    if (n.args.empty() || n.op == dag_op::user_call)
+    {
+      return std::nullopt;
+    }
+    const auto a = literal(n.args[0]);
+    const auto b = n.args.size() > 1 ? literal(n.args[1]) : std::nullopt;
+    if (n.op == dag_op::select)
+    {
+      if (a)
+      {
+        return *a != 0.0 ? n.args[1] : n.args[2];
+      }
+      return n.args[1] == n.args[2] ? std::optional(n.args[1]) : std::nullopt;
+    }
+    if (a && (n.args.size() == 1 || b))
+    {
+      auto value = [&]
+      {
+        switch (n.op)
+        {
+        case dag_op::neg:
+          return -*a;
+        case dag_op::add:
+          return *a + *b;
+        case dag_op::sub:
+          return *a - *b;
+        case dag_op::mul:
+          return *a * *b;
+        case dag_op::div:
+          return *a / *b;
+        case dag_op::less:
+          return truth<double>(*a < *b);
+        case dag_op::less_equal:
+          return truth<double>(*a <= *b);
+        case dag_op::greater:
+          return truth<double>(*a > *b);
+        case dag_op::greater_equal:
+          return truth<double>(*a >= *b);
+        case dag_op::equal:
+          return truth<double>(*a == *b);
+        case dag_op::not_equal:
+          return truth<double>(*a != *b);
+        case dag_op::logical_and:
+          return truth<double>(*a != 0.0 && *b != 0.0);
+        case dag_op::logical_or:
+          return truth<double>(*a != 0.0 || *b != 0.0);
+        case dag_op::logical_not:
+          return truth<double>(*a == 0.0);
+        case dag_op::unary_call:
+          return (*find_unary_function_fp64(n.name))(*a);
+        case dag_op::binary_call:
+          return (*find_binary_function_fp64(n.name))(*a, *b);
+        default:
+          assert(false);
+          return 0.0;
+        }
+      }();
+      return add(dag_node{.op = dag_op::literal, .value = value});
+    }
+    if ((n.op == dag_op::add && a == 0.0) || (n.op == dag_op::mul && a == 1.0))
+    {
+      return n.args[1];
+    }
+    if (((n.op == dag_op::add || n.op == dag_op::sub) && b == 0.0)
+        || ((n.op == dag_op::mul || n.op == dag_op::div) && b == 1.0))
+    {
+      return n.args[0];
+    }
+    return std::nullopt;
+  }
+
+  uint32_t add(dag_node n)
+  {
+    if (auto folded = fold(n))
+    {
+      return *folded;
+    }
+    auto key = node_key{n.op, std::bit_cast<uint64_t>(n.value), n.name, n.idx, n.args};
+    if (auto it = known.find(key); it != known.end())
+    {
+      return it->second;
+    }
+    const auto idx = static_cast<uint32_t>(dag.nodes.size());
+    dag.nodes.push_back(std::move(n));
+    known.emplace(std::move(key), idx);
+    return idx;
+  }
+
+  uint32_t add(dag_op op, std::vector<uint32_t> args, std::string name = {})
+  {
+    return add(dag_node{.op = op, .name = std::move(name), .args = std::move(args)});
+  }
+
+  uint32_t build(const expr &e)
+  {
+    auto nodes = std::vector<uint32_t>();
+    nodes.reserve(e.nodes.size());
+    for (const auto &n : e.nodes)
+    {
+      auto args = std::vector<uint32_t>();
+      for (auto a : e.args_of(n))
+      {
+        args.push_back(nodes[a]);
+      }
+      nodes.push_back(build(e, n, std::move(args)));
+    }
+    return nodes.back();
+  }
+
+  uint32_t build(const expr &e, const expr_node &n, std::vector<uint32_t> args)
+  {
+    switch (n.op)
+    {
+    case expr_op::literal:
+      return add(dag_node{.op = dag_op::literal, .value = n.value});
+    case expr_op::variable:
+      if (auto it =
+              std::ranges::find(params, e.name_of(n), &std::pair<std::string, uint32_t>::first);
+          it != params.end())
+      {
+        return it->second;
+      }
+      return add(dag_node{.op = dag_op::variable, .name = e.name_of(n)});
+    case expr_op::column:
+      return add(dag_node{.op = dag_op::column, .idx = n.idx});
+    case expr_op::user_variable:
+      if (inlining == user_inlining::all || !constant_value(n.idx))
+      {
+        auto inner = dag_builder{dag, known, inlining, {}};
+        return inner.build(simplify(get_definition(n.idx).body));
+      }
+      return add(dag_node{.op = dag_op::user_variable, .idx = n.idx});
+    case expr_op::neg:
+      return add(dag_op::neg, std::move(args));
+    case expr_op::add:
+      return add(dag_op::add, std::move(args));
+    case expr_op::sub:
+      return add(dag_op::sub, std::move(args));
+    case expr_op::mul:
+      return add(dag_op::mul, std::move(args));
+    case expr_op::div:
+      return add(dag_op::div, std::move(args));
+    case expr_op::less:
+      return add(dag_op::less, std::move(args));
+    case expr_op::less_equal:
+      return add(dag_op::less_equal, std::move(args));
+    case expr_op::greater:
+      return add(dag_op::greater, std::move(args));
+    case expr_op::greater_equal:
+      return add(dag_op::greater_equal, std::move(args));
+    case expr_op::equal:
+      return add(dag_op::equal, std::move(args));
+    case expr_op::not_equal:
+      return add(dag_op::not_equal, std::move(args));
+    case expr_op::logical_and:
+      return add(dag_op::logical_and, std::move(args));
+    case expr_op::logical_or:
+      return add(dag_op::logical_or, std::move(args));
+    case expr_op::logical_not:
+      return add(dag_op::logical_not, std::move(args));
+    case expr_op::select:
+      return add(dag_op::select, std::move(args));
+    case expr_op::unary_call:
+      return add(dag_op::unary_call, std::move(args), e.name_of(n));
+    case expr_op::binary_call:
+      return add(dag_op::binary_call, std::move(args), e.name_of(n));
+    case expr_op::user_call:
+      return call(n.idx, std::move(args));
+    }
+    assert(false);
+    return 0;
+  }
+
+  uint32_t call(uint32_t idx, std::vector<uint32_t> args)
+  {
+    const auto &def = get_definition(idx);
+    if (inlining == user_inlining::all
+        || std::ranges::any_of(args, [&](uint32_t a) { return literal(a).has_value(); })
+        || def.body.nodes.size() <= max_inlined_size || uses_inputs(def.body, *def.params))
+    {
+      assert(def.params && def.params->size() == args.size());
+      auto inner = dag_builder{dag, known, inlining, {}};
+      for (auto i = 0uz; i < args.size(); ++i)
+      {
+        inner.params.emplace_back(def.params->at(i), args[i]);
+      }
+      return inner.build(simplify(def.body));
+    }
+    return add(dag_node{.op = dag_op::user_call, .idx = idx, .args = std::move(args)});
+  }
+};
+} // namespace
+
+namespace explot
+{
+expr_dag make_dag(std::span<const expr> exprs, user_inlining inlining)
+{
+  auto dag = expr_dag();
+  auto known = std::map<node_key, uint32_t>();
+  auto builder = dag_builder{dag, known, inlining, {}};
+  for (const auto &e : exprs)
+  {
+    dag.roots.push_back(builder.build(simplify(e)));
+  }
+
+  for (const auto &n : dag.nodes)
+  {
+    for (auto arg : n.args)
+    {
+      ++dag.nodes[arg].uses;
+    }
+  }
+  for (auto root : dag.roots)
+  {
+    ++dag.nodes[root].uses;
+  }
+  return dag;
+}
+} // namespace explot
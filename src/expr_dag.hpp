@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "commands.hpp"
+
+namespace explot
+{
+enum class dag_op : uint8_t
+{
+  literal,
+  variable,
+  column,
+  user_variable,
+  neg,
+  add,
+  sub,
+  mul,
+  div,
+  less,
+  less_equal,
+  greater,
+  greater_equal,
+  equal,
+  not_equal,
+  logical_and,
+  logical_or,
+  logical_not,
+  select,
+  unary_call,
+  binary_call,
+  user_call
+};
+
+struct dag_node
+{
+  dag_op op;
+  double value = 0.0;
+  // name of the variable or the builtin
+  std::string name{};
+  // index of the column or the user definition
+  uint32_t idx = 0;
+  std::vector<uint32_t> args{};
+  // number of nodes and roots that use this node
+  uint32_t uses = 0;
+};
+
+// Simplified expressions as a hash-consed DAG, so that equal subexpressions, also across
+// expressions, are the same node. Nodes come after their arguments. roots[i] is the node of the
+// i-th expression.
+struct expr_dag
+{
+  std::vector<dag_node> nodes;
+  std::vector<uint32_t> roots;
+};
+
+enum class user_inlining : uint8_t
+{
+  // the bodies of all user functions and variables become part of the DAG
+  all,
+  // Constant variables are user_variable nodes and functions user_call nodes, except for small
+  // functions, calls with literal arguments, which are specialized, and definitions that use inputs
+  // like x or columns. Those are inlined, so that they can be folded.
+  calls
+};
+
+// Nodes with literal arguments are folded, also after arguments of inlined functions are
+// substituted.
+expr_dag make_dag(std::span<const expr> exprs, user_inlining inlining);
+
+inline bool is_leaf(const dag_node &n) { return n.args.empty(); }
+} // namespace explot
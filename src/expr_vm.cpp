@@ -0,0 +1,363 @@
+#include "expr_vm.hpp"
+#include "expr_dag.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <type_traits>
+
+namespace
+{
+using namespace explot;
+
+template <typename T>
+struct alignas(64) vm_register
+{
+  std::array<T, batch_size> values;
+};
+
+struct compiler
+{
+  vm_program &program;
+
+  uint16_t new_register()
+  {
+    assert(program.num_registers < std::numeric_limits<uint16_t>::max());
+    return program.num_registers++;
+  }
+
+  uint16_t emit(opcode op, uint16_t lhs, uint16_t rhs = 0, uint16_t func = 0)
+  {
+    const auto dst = new_register();
+    program.code.push_back(instruction{op, dst, lhs, rhs, func});
+    return dst;
+  }
+
+  uint16_t constant(double value)
+  {
+    program.constants.push_back(value);
+    return program.constant_registers.emplace_back(new_register());
+  }
+
+  uint16_t input(vm_input in)
+  {
+    program.inputs.push_back(std::move(in));
+    return program.input_registers.emplace_back(new_register());
+  }
+
+  template <typename F>
+  uint16_t function_index(std::vector<F> &functions, F f)
+  {
+    auto it = std::ranges::find(functions, f);
+    if (it == functions.end())
+    {
+      functions.push_back(f);
+      return static_cast<uint16_t>(functions.size() - 1);
+    }
+    return static_cast<uint16_t>(std::distance(functions.begin(), it));
+  }
+
+  // the nodes are unique, so every node gets its own register
+  uint16_t compile(const dag_node &n, std::span<const uint16_t> registers)
+  {
+    auto arg = [&](std::size_t a) { return registers[n.args[a]]; };
+    switch (n.op)
+    {
+    case dag_op::literal:
+      return constant(n.value);
+    case dag_op::variable:
+      return input(var{n.name});
+    case dag_op::column:
+      if (n.idx == 0)
+      {
+        program.row_register = new_register();
+        return *program.row_register;
+      }
+      return input(data_ref{static_cast<int>(n.idx)});
+    case dag_op::neg:
+      return emit(opcode::neg, arg(0));
+    case dag_op::add:
+      return emit(opcode::add, arg(0), arg(1));
+    case dag_op::sub:
+      return emit(opcode::sub, arg(0), arg(1));
+    case dag_op::mul:
+      return emit(opcode::mul, arg(0), arg(1));
+    case dag_op::div:
+      return emit(opcode::div, arg(0), arg(1));
+    case dag_op::less:
+      return emit(opcode::less, arg(0), arg(1));
+    case dag_op::less_equal:
+      return emit(opcode::less_equal, arg(0), arg(1));
+    case dag_op::greater:
+      return emit(opcode::greater, arg(0), arg(1));
+    case dag_op::greater_equal:
+      return emit(opcode::greater_equal, arg(0), arg(1));
+    case dag_op::equal:
+      return emit(opcode::equal, arg(0), arg(1));
+    case dag_op::not_equal:
+      return emit(opcode::not_equal, arg(0), arg(1));
+    case dag_op::logical_and:
+      return emit(opcode::logical_and, arg(0), arg(1));
+    case dag_op::logical_or:
+      return emit(opcode::logical_or, arg(0), arg(1));
+    case dag_op::logical_not:
+      return emit(opcode::logical_not, arg(0));
+    case dag_op::select:
+      return emit(opcode::select, arg(0), arg(1), arg(2));
+    case dag_op::unary_call:
+    {
+      const auto f = find_unary_function(n.name);
+      assert(f.has_value());
+      const auto idx = function_index(program.unary_functions, *f);
+      if (idx == program.unary_functions_fp64.size())
+      {
+        program.unary_functions_fp64.push_back(*find_unary_function_fp64(n.name));
+        program.unary_kernels.push_back(*find_unary_kernel(n.name));
+      }
+      return emit(opcode::unary_call, arg(0), 0, idx);
+    }
+    case dag_op::binary_call:
+    {
+      const auto f = find_binary_function(n.name);
+      assert(f.has_value());
+      const auto idx = function_index(program.binary_functions, *f);
+      if (idx == program.binary_functions_fp64.size())
+      {
+        program.binary_functions_fp64.push_back(*find_binary_function_fp64(n.name));
+        program.binary_kernels.push_back(*find_binary_kernel(n.name));
+      }
+      return emit(opcode::binary_call, arg(0), arg(1), idx);
+    }
+    case dag_op::user_variable:
+    case dag_op::user_call:
+      break;
+    }
+    // user definitions are inlined by make_dag
+    assert(false);
+    return 0;
+  }
+};
+
+template <typename T, typename U, typename B>
+void run(const vm_program &program, std::span<vm_register<T>> registers,
+         std::span<const U> unary_functions, std::span<const B> binary_functions)
+{
+  for (const auto &ins : program.code)
+  {
+    auto &dst = registers[ins.dst].values;
+    const auto &lhs = registers[ins.lhs].values;
+    const auto &rhs = registers[ins.rhs].values;
+    switch (ins.op)
+    {
+    case opcode::neg:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = -lhs[i];
+      }
+      break;
+    case opcode::add:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = lhs[i] + rhs[i];
+      }
+      break;
+    case opcode::sub:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = lhs[i] - rhs[i];
+      }
+      break;
+    case opcode::mul:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = lhs[i] * rhs[i];
+      }
+      break;
+    case opcode::div:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = lhs[i] / rhs[i];
+      }
+      break;
+    case opcode::less:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] < rhs[i]);
+      }
+      break;
+    case opcode::less_equal:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] <= rhs[i]);
+      }
+      break;
+    case opcode::greater:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] > rhs[i]);
+      }
+      break;
+    case opcode::greater_equal:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] >= rhs[i]);
+      }
+      break;
+    case opcode::equal:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] == rhs[i]);
+      }
+      break;
+    case opcode::not_equal:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] != rhs[i]);
+      }
+      break;
+    case opcode::logical_and:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] != T(0) && rhs[i] != T(0));
+      }
+      break;
+    case opcode::logical_or:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] != T(0) || rhs[i] != T(0));
+      }
+      break;
+    case opcode::logical_not:
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = truth<T>(lhs[i] == T(0));
+      }
+      break;
+    case opcode::select:
+    {
+      // both values are evaluated for every row, so this is a blend, which can be vectorized
+      const auto &otherwise = registers[ins.func].values;
+      for (auto i = 0uz; i < batch_size; ++i)
+      {
+        dst[i] = lhs[i] != T(0) ? rhs[i] : otherwise[i];
+      }
+      break;
+    }
+    case opcode::unary_call:
+      if constexpr (std::is_same_v<T, float>)
+      {
+        program.unary_kernels[ins.func](lhs.data(), dst.data(), batch_size);
+      }
+      else
+      {
+        const auto f = unary_functions[ins.func];
+        for (auto i = 0uz; i < batch_size; ++i)
+        {
+          dst[i] = f(lhs[i]);
+        }
+      }
+      break;
+    case opcode::binary_call:
+      if constexpr (std::is_same_v<T, float>)
+      {
+        program.binary_kernels[ins.func](lhs.data(), rhs.data(), dst.data(), batch_size);
+      }
+      else
+      {
+        const auto f = binary_functions[ins.func];
+        for (auto i = 0uz; i < batch_size; ++i)
+        {
+          dst[i] = f(lhs[i], rhs[i]);
+        }
+      }
+      break;
+    }
+  }
+}
+
+template <typename T, typename C, typename U, typename B>
+void evaluate_(const vm_program &program, std::span<const C> inputs, uint32_t first_row,
+               uint32_t num_rows, std::span<T> result, std::span<const U> unary_functions,
+               std::span<const B> binary_functions)
+{
+  assert(inputs.size() == program.inputs.size());
+  const auto num_outputs = program.outputs.size();
+  assert(result.size() >= num_rows * num_outputs);
+
+  auto registers = std::vector<vm_register<T>>(program.num_registers);
+  for (auto i = 0uz; i < program.constants.size(); ++i)
+  {
+    registers[program.constant_registers[i]].values.fill(static_cast<T>(program.constants[i]));
+  }
+
+  // the lanes after the last row of the last batch keep values of the previous batch. They are
+  // evaluated but never written to result.
+  for (auto first = 0u; first < num_rows; first += batch_size)
+  {
+    const auto n = std::min(static_cast<uint32_t>(batch_size), num_rows - first);
+    for (auto i = 0uz; i < inputs.size(); ++i)
+    {
+      auto &values = registers[program.input_registers[i]].values;
+      const auto column = inputs[i];
+      for (auto j = 0u; j < n; ++j)
+      {
+        values[j] = column.data[(first + j) * column.stride];
+      }
+    }
+    if (program.row_register)
+    {
+      auto &values = registers[*program.row_register].values;
+      for (auto j = 0u; j < batch_size; ++j)
+      {
+        values[j] = static_cast<T>(first_row + first + j);
+      }
+    }
+
+    run<T>(program, registers, unary_functions, binary_functions);
+
+    for (auto j = 0u; j < n; ++j)
+    {
+      for (auto o = 0uz; o < num_outputs; ++o)
+      {
+        result[(first + j) * num_outputs + o] = registers[program.outputs[o]].values[j];
+      }
+    }
+  }
+}
+} // namespace
+
+namespace explot
+{
+vm_program compile(std::span<const expr> exprs)
+{
+  auto program = vm_program();
+  const auto dag = make_dag(exprs, user_inlining::all);
+  auto c = compiler{program};
+  auto registers = std::vector<uint16_t>();
+  registers.reserve(dag.nodes.size());
+  for (const auto &n : dag.nodes)
+  {
+    registers.push_back(c.compile(n, registers));
+  }
+  for (auto root : dag.roots)
+  {
+    program.outputs.push_back(registers[root]);
+  }
+  return program;
+}
+
+void evaluate(const vm_program &program, std::span<const vm_column> inputs, uint32_t first_row,
+              uint32_t num_rows, std::span<float> result)
+{
+  evaluate_<float>(program, inputs, first_row, num_rows, result,
+                   std::span(program.unary_functions), std::span(program.binary_functions));
+}
+
+void evaluate_fp64(const vm_program &program, std::span<const vm_column_fp64> inputs,
+                   uint32_t first_row, uint32_t num_rows, std::span<double> result)
+{
+  evaluate_<double>(program, inputs, first_row, num_rows, result,
+                    std::span(program.unary_functions_fp64),
+                    std::span(program.binary_functions_fp64));
+}
+} // namespace explot
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <variant>
+#include <vector>
+#include "commands.hpp"
+#include "parse_ast.hpp"
+
+namespace explot
+{
+// Expressions are evaluated for batch_size rows at once. Every register holds one value per row,
+// so every instruction works on a whole batch and the loops in evaluate can be vectorized.
+constexpr auto batch_size = 16uz;
+
+enum class opcode : uint8_t
+{
+  neg,
+  add,
+  sub,
+  mul,
+  div,
+  less,
+  less_equal,
+  greater,
+  greater_equal,
+  equal,
+  not_equal,
+  logical_and,
+  logical_or,
+  logical_not,
+  select,
+  unary_call,
+  binary_call
+};
+
+struct instruction
+{
+  opcode op;
+  uint16_t dst;
+  uint16_t lhs;
+  uint16_t rhs;
+  // index into unary_functions or binary_functions of the program, or the register of the value of
+  // select if lhs is 0
+  uint16_t func;
+};
+
+// an input of a program, either a variable like x or t or a column of a datafile. Column 0, the
+// row number, is not an input. It is generated by evaluate.
+using vm_input = std::variant<var, data_ref>;
+
+// A register-based bytecode for expr, which can be evaluated without a GL context. User functions
+// and variables are inlined and common subexpressions of all expressions are evaluated once.
+struct vm_program
+{
+  std::vector<instruction> code;
+  std::vector<vm_input> inputs;
+  std::vector<uint16_t> input_registers;
+  std::vector<double> constants;
+  std::vector<uint16_t> constant_registers;
+  std::optional<uint16_t> row_register;
+  std::vector<uint16_t> outputs;
+  std::vector<unary_function> unary_functions;
+  std::vector<binary_function> binary_functions;
+  // the same functions for whole registers, used by evaluate
+  std::vector<unary_kernel> unary_kernels;
+  std::vector<binary_kernel> binary_kernels;
+  // the same functions in double precision for evaluate_fp64
+  std::vector<unary_function_fp64> unary_functions_fp64;
+  std::vector<binary_function_fp64> binary_functions_fp64;
+  uint16_t num_registers = 0;
+};
+
+vm_program compile(std::span<const expr> exprs);
+
+// values of an input for consecutive rows, stride elements apart
+struct vm_column
+{
+  const float *data;
+  std::size_t stride;
+};
+
+// Evaluates the expressions of program for num_rows rows. inputs[i] holds the values of
+// program.inputs[i]. first_row is the row number of the first row. The results are written row by
+// row to result, which needs num_rows * program.outputs.size() elements.
+void evaluate(const vm_program &program, std::span<const vm_column> inputs, uint32_t first_row,
+              uint32_t num_rows, std::span<float> result);
+
+struct vm_column_fp64
+{
+  const double *data;
+  std::size_t stride;
+};
+
+// evaluate in double precision, with the literals as precise as they were written
+void evaluate_fp64(const vm_program &program, std::span<const vm_column_fp64> inputs,
+                   uint32_t first_row, uint32_t num_rows, std::span<double> result);
+} // namespace explot
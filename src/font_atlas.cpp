@@ -68,7 +68,7 @@ void main()
 
 auto make_string_program()
 {
-  return make_program(nullptr, string_vertex_shader_src, fragment_shader_src);
+  return clone_program(make_program(nullptr, string_vertex_shader_src, fragment_shader_src));
 }
 
 auto make_atlas_program()
@@ -2,6 +2,8 @@
 
 #include <GL/glew.h>
 #include <cassert>
+#include <memory>
+#include <utility>
 
 namespace explot
 {
@@ -44,6 +46,30 @@ public:
   }
 };
 
+// Copies of a shared_gl_handle refer to the same object, which is deleted with the last copy.
+template <void (*delete_handle)(gl_id)>
+class shared_gl_handle final
+{
+  std::shared_ptr<const gl_handle<delete_handle>> handle;
+
+public:
+  shared_gl_handle() = default;
+  explicit shared_gl_handle(gl_id id) : handle(std::make_shared<gl_handle<delete_handle>>(id)) {}
+  shared_gl_handle(gl_handle<delete_handle> &&h)
+      : handle(std::make_shared<gl_handle<delete_handle>>(std::move(h)))
+  {
+  }
+
+  // the number of copies, which refer to the object
+  long use_count() const noexcept { return handle.use_count(); }
+
+  operator gl_id() const noexcept
+  {
+    assert(handle);
+    return *handle;
+  }
+};
+
 namespace detail
 {
 inline void delete_vao(gl_id id) { glDeleteVertexArrays(1, &id); }
@@ -73,7 +99,10 @@ inline vbo_handle make_vbo()
   return vbo_handle(id);
 }
 
-using program_handle = gl_handle<detail::delete_program>;
+// a buffer, which can be shared, like the points of a datafile by graphs and the cache of them
+using shared_vbo_handle = shared_gl_handle<detail::delete_vbo>;
+
+using program_handle = shared_gl_handle<detail::delete_program>;
 inline program_handle make_program() { return program_handle(glCreateProgram()); }
 
 using texture_handle = gl_handle<detail::delete_texture>;
@@ -0,0 +1,326 @@
+#include "gpu_csv.hpp"
+#include "prefix_sum.hpp"
+#include "program.hpp"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+using namespace explot;
+
+// newlines and fields are counted with prefix_sum, which works on floats. Floats count exactly up
+// to 2^24, which limits the size of a chunk.
+constexpr auto chunk_size = 1uz << 24;
+constexpr auto max_columns = 32uz;
+constexpr auto local_size = 256u;
+
+constexpr auto prelude = R"(#version 430 core
+layout(local_size_x = 256) in;
+layout(std430, binding = 0) readonly buffer bytes_block { uint bytes[]; };
+uniform uint size;
+uniform uint delim;
+uint byte_at(uint i) { return (bytes[i >> 2] >> ((i & 3u) * 8u)) & 0xffu; }
+bool is_separator(uint c) { return c == 10u || c == delim; }
+)";
+
+constexpr auto classify_shader = R"(
+layout(std430, binding = 1) writeonly buffer newlines_block { float newlines[]; };
+layout(std430, binding = 2) writeonly buffer fields_block { float fields[]; };
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i < size)
+  {
+    uint c = byte_at(i);
+    newlines[i] = c == 10u ? 1.0 : 0.0;
+    fields[i] = is_separator(c) ? 1.0 : 0.0;
+  }
+}
+)";
+
+// After the prefix sums, newlines[i] is the number of lines ending at or before i and fields[i]
+// the number of fields. row_fields[r] is the number of fields before row r.
+constexpr auto rows_shader = R"(
+layout(std430, binding = 1) readonly buffer newlines_block { float newlines[]; };
+layout(std430, binding = 2) readonly buffer fields_block { float fields[]; };
+layout(std430, binding = 3) writeonly buffer row_fields_block { uint row_fields[]; };
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i == 0u)
+  {
+    row_fields[0] = 0u;
+  }
+  if (i < size && byte_at(i) == 10u)
+  {
+    row_fields[uint(newlines[i])] = uint(fields[i]);
+  }
+}
+)";
+
+constexpr auto parse_shader = R"(
+layout(std430, binding = 1) readonly buffer newlines_block { float newlines[]; };
+layout(std430, binding = 2) readonly buffer fields_block { float fields[]; };
+layout(std430, binding = 3) readonly buffer row_fields_block { uint row_fields[]; };
+layout(std430, binding = 4) writeonly buffer values_block { float values[]; };
+// set, if a field is not a number
+layout(std430, binding = 5) writeonly buffer failed_block { uint failed; };
+
+uniform uint num_columns;
+uniform uint columns[32];
+
+bool is_digit(uint c) { return c >= 48u && c <= 57u; }
+
+// Parses a field like std::from_chars does and returns false, if the field is not a number up to
+// its end. Every field ends with a separator or newline, which stops all loops.
+bool parse_number(uint i, out float value)
+{
+  uint c = byte_at(i);
+  double sign = 1.0lf;
+  if (c == 45u)
+  {
+    sign = -1.0lf;
+    c = byte_at(++i);
+  }
+  double mantissa = 0.0lf;
+  int exponent = 0;
+  uint digits = 0u;
+  while (is_digit(c))
+  {
+    mantissa = mantissa * 10.0lf + double(c - 48u);
+    ++digits;
+    c = byte_at(++i);
+  }
+  if (c == 46u)
+  {
+    c = byte_at(++i);
+    while (is_digit(c))
+    {
+      mantissa = mantissa * 10.0lf + double(c - 48u);
+      --exponent;
+      ++digits;
+      c = byte_at(++i);
+    }
+  }
+  if (digits == 0u)
+  {
+    return false;
+  }
+  if (c == 101u || c == 69u)
+  {
+    c = byte_at(++i);
+    int exponent_sign = 1;
+    if (c == 45u || c == 43u)
+    {
+      exponent_sign = c == 45u ? -1 : 1;
+      c = byte_at(++i);
+    }
+    if (!is_digit(c))
+    {
+      return false;
+    }
+    int e = 0;
+    while (is_digit(c))
+    {
+      e = e * 10 + int(c - 48u);
+      c = byte_at(++i);
+    }
+    exponent += exponent_sign * e;
+  }
+  double scale = 1.0lf;
+  double power = 10.0lf;
+  for (uint n = uint(abs(exponent)); n > 0u; n >>= 1)
+  {
+    if ((n & 1u) != 0u)
+    {
+      scale *= power;
+    }
+    power *= power;
+  }
+  value = float(sign * (exponent < 0 ? mantissa / scale : mantissa * scale));
+  return is_separator(c);
+}
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i >= size || byte_at(i) == 10u || (i > 0u && !is_separator(byte_at(i - 1u))))
+  {
+    return;
+  }
+  uint row = i == 0u ? 0u : uint(newlines[i - 1u]);
+  // 1-based like the columns in using
+  uint field = (i == 0u ? 0u : uint(fields[i - 1u])) - row_fields[row] + 1u;
+  for (uint j = 0u; j < num_columns; ++j)
+  {
+    if (columns[j] == field)
+    {
+      float value = 0.0;
+      if (!parse_number(i, value))
+      {
+        failed = 1u;
+      }
+      values[row * num_columns + j] = value;
+    }
+  }
+}
+)";
+
+program_handle make_csv_program(const char *shader)
+{
+  auto src = fmt::format("{}{}", prelude, shader);
+  return make_compute_program(src.c_str());
+}
+
+struct gpu_parser
+{
+  program_handle classify = make_csv_program(classify_shader);
+  program_handle rows = make_csv_program(rows_shader);
+  program_handle parse = make_csv_program(parse_shader);
+  vbo_handle bytes = make_vbo();
+  vbo_handle newlines = make_vbo();
+  vbo_handle fields = make_vbo();
+  vbo_handle row_fields = make_vbo();
+  vbo_handle failed = make_vbo();
+};
+
+void allocate(gl_id buffer, std::size_t bytes, const void *data = nullptr)
+{
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(bytes), data, GL_STREAM_DRAW);
+}
+
+void dispatch(gl_id program, uint32_t size)
+{
+  glUseProgram(program);
+  glDispatchCompute((size + local_size - 1) / local_size, 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// text has to end with a newline and must be padded to a multiple of 4 bytes
+row_chunk parse_chunk(const gpu_parser &parser, std::span<const char> text, uint32_t size,
+                      char delim, std::span<const uint32_t> columns)
+{
+  allocate(parser.bytes, text.size(), text.data());
+  allocate(parser.newlines, size * sizeof(float));
+  allocate(parser.fields, size * sizeof(float));
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, parser.bytes);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, parser.newlines);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, parser.fields);
+
+  const auto delim_code = static_cast<uint32_t>(static_cast<unsigned char>(delim));
+  const auto num_columns = static_cast<uint32_t>(columns.size());
+  for (auto program : {gl_id(parser.classify), gl_id(parser.rows), gl_id(parser.parse)})
+  {
+    uniform ufs[] = {{"size", size}, {"delim", delim_code}};
+    set_uniforms(program, ufs);
+  }
+  uniform parse_ufs[] = {{"num_columns", num_columns}, {"columns", columns}};
+  set_uniforms(parser.parse, parse_ufs);
+
+  dispatch(parser.classify, size);
+  prefix_sum(parser.newlines, size);
+  prefix_sum(parser.fields, size);
+
+  auto num_rows = 0.0f;
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, parser.newlines);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, (size - 1) * sizeof(float), sizeof(float),
+                     &num_rows);
+  const auto rows = static_cast<uint32_t>(num_rows);
+
+  auto values = make_vbo();
+  allocate(parser.row_fields, (rows + 1) * sizeof(uint32_t));
+  allocate(values, rows * columns.size() * sizeof(float));
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, nullptr);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, parser.bytes);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, parser.newlines);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, parser.fields);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, parser.row_fields);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, values);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, parser.failed);
+  dispatch(parser.rows, size);
+  dispatch(parser.parse, size);
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+  return row_chunk{std::move(values), rows};
+}
+} // namespace
+
+namespace explot
+{
+std::vector<row_chunk> parse_csv_on_gpu(const std::filesystem::path &p, char delim,
+                                        std::span<const int> indices, shared_timebase &timebase)
+{
+  if (indices.size() > max_columns)
+  {
+    return upload_csv(p, delim, indices, timebase);
+  }
+
+  auto columns = std::vector<uint32_t>(indices.begin(), indices.end());
+  auto parser = gpu_parser();
+  auto failed = 0u;
+  allocate(parser.failed, sizeof(failed), &failed);
+  auto vao = make_vao();
+  glBindVertexArray(vao);
+
+  auto result = std::vector<row_chunk>();
+  auto f = std::ifstream(p, std::ios::binary);
+  // room for a missing newline at the end of the file and the padding
+  auto buffer = std::make_unique_for_overwrite<char[]>(chunk_size + 4);
+  auto offset = 0uz;
+  auto at_end = !f.is_open();
+  while (!at_end)
+  {
+    f.read(buffer.get() + offset, static_cast<std::streamsize>(chunk_size - offset));
+    auto size = offset + static_cast<std::size_t>(f.gcount());
+    at_end = !f;
+    if (size == 0)
+    {
+      break;
+    }
+
+    // only whole lines are parsed, the rest is moved to the next chunk
+    auto end = size;
+    if (at_end)
+    {
+      if (buffer[size - 1] != '\n')
+      {
+        buffer[size++] = '\n';
+      }
+      end = size;
+    }
+    else
+    {
+      auto last_newline = std::find(std::reverse_iterator(buffer.get() + size),
+                                    std::reverse_iterator(buffer.get()), '\n');
+      if (last_newline.base() == buffer.get())
+      {
+        fmt::println("line longer than {} bytes in {}", chunk_size, p.c_str());
+        break;
+      }
+      end = static_cast<std::size_t>(last_newline.base() - buffer.get());
+    }
+
+    auto padded = (end + 3) & ~3uz;
+    result.push_back(parse_chunk(parser, std::span(buffer.get(), padded),
+                                 static_cast<uint32_t>(end), delim, columns));
+    offset = size - end;
+    std::memmove(buffer.get(), buffer.get() + end, offset);
+  }
+  // fields like dates, which are not numbers, are parsed on the CPU
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, parser.failed);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(failed), &failed);
+  if (failed != 0)
+  {
+    return upload_csv(p, delim, indices, timebase);
+  }
+  std::erase_if(result, [](const row_chunk &c) { return c.num_rows == 0; });
+  return result;
+}
+} // namespace explot
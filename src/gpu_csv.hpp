@@ -0,0 +1,13 @@
+#pragma once
+
+#include "csv_upload.hpp"
+
+namespace explot
+{
+// Parses the columns in indices with compute shaders. The file is uploaded in chunks of whole
+// lines, separators and newlines are classified and counted with prefix_sum and every field is
+// parsed by its own invocation. Only numbers are supported, files with other fields, e.g. dates,
+// are read again with upload_csv.
+std::vector<row_chunk> parse_csv_on_gpu(const std::filesystem::path &p, char delim,
+                                        std::span<const int> indices, shared_timebase &timebase);
+} // namespace explot
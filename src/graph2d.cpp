@@ -1,9 +1,10 @@
 #include "graph2d.hpp"
 #include "overload.hpp"
+#include <cassert>
 
 namespace explot
 {
-graph2d::graph2d(vbo_handle vbo, const seq_data_desc &d, mark_type_2d mark, line_type lt)
+graph2d::graph2d(shared_vbo_handle vbo, const seq_data_desc &d, mark_type_2d mark, line_type lt)
     : vbo(std::move(vbo)), graph(
                                [&]() -> typename graph2d::state
                                {
@@ -26,7 +27,7 @@ graph2d::graph2d(vbo_handle vbo, const seq_data_desc &d, mark_type_2d mark, line
                                  }
                                  throw "bad";
                                }()),
-      lt(lt)
+      lt(lt), origin(d.origin)
 {
 }
 
@@ -39,6 +40,36 @@ void update(const graph2d &graph, const transforms_2d &transforms)
              graph.graph);
 }
 
+void resize(graph2d &graph, uint32_t first, uint32_t num_points, uint32_t capacity)
+{
+  assert(first < capacity && num_points <= capacity);
+  const auto strip = [&](draw_info &data)
+  {
+    if (first + num_points <= capacity)
+    {
+      GLsizei starts[] = {static_cast<GLsizei>(first)};
+      set_ranges(data, {static_cast<GLsizei>(num_points)}, starts);
+    }
+    else
+    {
+      // the first range ends with the copy of point 0, where the second one starts
+      GLsizei starts[] = {static_cast<GLsizei>(first), 0};
+      set_ranges(data,
+                 {static_cast<GLsizei>(capacity - first + 1),
+                  static_cast<GLsizei>(first + num_points - capacity)},
+                 starts);
+    }
+  };
+  // the order of points and impulses does not matter, they are always in [0, num_points)
+  std::visit(
+      overload([&](points_2d_state &s) { set_count(s.data, {static_cast<GLsizei>(num_points)}); },
+               [&](line_strip_state_2d &s) { strip(s.data); },
+               [&](dashed_line_strip_state_2d &s) { strip(s.data); },
+               [&](impulses_state &s)
+               { set_count(s.lines.data, {static_cast<GLsizei>(2 * num_points)}); }),
+      graph.graph);
+}
+
 void draw(const graph2d &graph)
 {
   std::visit(overload([&](const points_2d_state &s) { draw(s); }, [&](const line_strip_state_2d &s)
@@ -15,12 +15,18 @@ struct graph2d final
 {
   using state = std::variant<points_2d_state, line_strip_state_2d, dashed_line_strip_state_2d,
                              impulses_state>;
-  vbo_handle vbo;
+  shared_vbo_handle vbo;
   state graph;
   line_type lt;
-  graph2d(vbo_handle vbo, const seq_data_desc &data, mark_type_2d mark, line_type line_type);
+  // the points are relative to origin
+  glm::vec2 origin;
+  graph2d(shared_vbo_handle vbo, const seq_data_desc &data, mark_type_2d mark, line_type line_type);
 };
 
 void update(const graph2d &graph, const transforms_2d &transforms);
+// Draws num_points points starting at first of a ring of capacity points. Line strips need a copy
+// of point 0 at position capacity to connect both ends of the ring. The graph has to be created
+// with at least capacity + 1 points.
+void resize(graph2d &graph, uint32_t first, uint32_t num_points, uint32_t capacity);
 void draw(const graph2d &graph);
 } // namespace explot
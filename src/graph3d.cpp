@@ -47,8 +47,9 @@ uint32_t get_point_size(const data_desc &d)
 
 namespace explot
 {
-graph3d::graph3d(vbo_handle v, const data_desc &data, mark_type_3d mark, line_type lt)
+graph3d::graph3d(shared_vbo_handle v, const data_desc &data, mark_type_3d mark, line_type lt)
     : vbo(std::move(v)), num_points(get_num_points(data)), point_size(get_point_size(data)),
+      bounds(std::visit([](const auto &d) { return d.bounds; }, data)),
       graph(make_state(vbo, data, mark, lt)), lt(lt)
 {
 }
@@ -13,10 +13,11 @@ namespace explot
 struct graph3d final
 {
   using state = std::variant<line_strip_state_3d, points_3d_state, surface_lines, pm3d_surface>;
-  explicit graph3d(vbo_handle vbo, const data_desc &data, mark_type_3d mark, line_type lt);
-  vbo_handle vbo;
+  explicit graph3d(shared_vbo_handle vbo, const data_desc &data, mark_type_3d mark, line_type lt);
+  shared_vbo_handle vbo;
   uint32_t num_points;
   uint32_t point_size;
+  std::optional<rect> bounds;
   state graph;
   line_type lt;
 };
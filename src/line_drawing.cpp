@@ -479,7 +479,8 @@ auto shape_for_lines(uint32_t segments)
 
 auto program_for_lines_2d()
 {
-  auto program = make_program(lines_geometry_shader_src, vertex_shader_src_2d, fragment_shader_src);
+  auto program = clone_program(
+      make_program(lines_geometry_shader_src, vertex_shader_src_2d, fragment_shader_src));
   auto s = shape_for_lines(3);
   glUseProgram(program);
   glUniform2fv(glGetUniformLocation(program, "shape"), 8, s.get());
@@ -488,7 +489,8 @@ auto program_for_lines_2d()
 
 auto program_for_lines_3d()
 {
-  auto program = make_program(lines_geometry_shader_src, vertex_shader_src_3d, fragment_shader_src);
+  auto program = clone_program(
+      make_program(lines_geometry_shader_src, vertex_shader_src_3d, fragment_shader_src));
   auto s = shape_for_lines(3);
   glUseProgram(program);
   glUniform2fv(glGetUniformLocation(program, "shape"), 8, s.get());
@@ -498,8 +500,8 @@ auto program_for_lines_3d()
 
 auto program_for_offset_lines_3d()
 {
-  auto program =
-      make_program(lines_geometry_shader_src, offset_vertex_shader_src_3d, fragment_shader_src);
+  auto program = clone_program(
+      make_program(lines_geometry_shader_src, offset_vertex_shader_src_3d, fragment_shader_src));
   auto s = shape_for_lines(3);
   glUseProgram(program);
   glUniform2fv(glGetUniformLocation(program, "shape"), 8, s.get());
@@ -539,13 +541,7 @@ void main()
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, points);
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, length);
 
-  auto program = make_program();
-  auto compute = glCreateShader(GL_COMPUTE_SHADER);
-  glShaderSource(compute, 1, &shader, nullptr);
-  glCompileShader(compute);
-  glAttachShader(program, compute);
-  glLinkProgram(program);
-  glDeleteShader(compute);
+  auto program = make_compute_program(shader);
 
   glUseProgram(program);
   glUniformMatrix4fv(glGetUniformLocation(program, "phase_to_screen"), 1, GL_FALSE,
@@ -558,8 +554,8 @@ void main()
 auto program_for_dashed_line_strip_2d(uint32_t num_uints)
 {
   auto dashed_fragment_shader = fmt::format(dashed_fragment_shader_fmt, num_uints);
-  auto program = make_program(dashed_geometry_shader, dashed_vertex_shader_src_2d,
-                              dashed_fragment_shader.c_str());
+  auto program = clone_program(make_program(dashed_geometry_shader, dashed_vertex_shader_src_2d,
+                                            dashed_fragment_shader.c_str()));
   GLint link_status;
   glGetProgramiv(program, GL_LINK_STATUS, &link_status);
   if (link_status != GL_TRUE)
@@ -0,0 +1,160 @@
+#include "live_source.hpp"
+#include "csv.hpp"
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <chrono>
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace
+{
+using namespace std::literals::chrono_literals;
+using namespace explot;
+
+#ifndef WIN32
+int connect_to(const std::filesystem::path &path)
+{
+  auto address = sockaddr_un{};
+  address.sun_family = AF_UNIX;
+  const auto &native = path.native();
+  if (native.size() >= sizeof(address.sun_path))
+  {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  std::memcpy(address.sun_path, native.c_str(), native.size() + 1);
+
+  auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+  {
+    const auto error = errno;
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
+
+void wait_for_retry(std::stop_token stop)
+{
+  for (auto i = 0; i < 10 && !stop.stop_requested(); ++i)
+  {
+    std::this_thread::sleep_for(50ms);
+  }
+}
+
+void read_socket(std::stop_token stop, live_source &source, std::filesystem::path path,
+                 char separator, std::vector<int> indices)
+{
+  static constexpr auto buffer_size = 1uz << 16;
+  auto buffer = std::make_unique_for_overwrite<char[]>(buffer_size);
+  auto timebase = std::optional<time_point>();
+  auto line = std::string();
+  auto parsed = std::vector<float>();
+  auto reported = false;
+
+  while (!stop.stop_requested())
+  {
+    auto fd = connect_to(path);
+    if (fd < 0)
+    {
+      if (!reported)
+      {
+        fmt::println("failed to connect to {}: {}", path.c_str(), std::strerror(errno));
+        reported = true;
+      }
+      wait_for_retry(stop);
+      continue;
+    }
+    reported = false;
+    line.clear();
+
+    while (!stop.stop_requested())
+    {
+      auto p = pollfd{.fd = fd, .events = POLLIN, .revents = 0};
+      auto ready = ::poll(&p, 1, 100);
+      if (ready < 0 && errno != EINTR)
+      {
+        break;
+      }
+      else if (ready <= 0)
+      {
+        continue;
+      }
+
+      auto received = ::read(fd, buffer.get(), buffer_size);
+      if (received <= 0)
+      {
+        break;
+      }
+
+      auto start_of_line = buffer.get();
+      const auto end = buffer.get() + received;
+      for (auto c = start_of_line; c != end; ++c)
+      {
+        if (*c == '\n')
+        {
+          line.append(start_of_line, c);
+          if (!line.empty() && line.back() == '\r')
+          {
+            line.pop_back();
+          }
+          if (!line.empty())
+          {
+            read_csv_line(line, separator, indices, timebase, parsed);
+          }
+          line.clear();
+          start_of_line = c + 1;
+        }
+      }
+      line.append(start_of_line, end);
+
+      if (!parsed.empty())
+      {
+        auto lock = std::scoped_lock(source.mutex);
+        source.rows.insert(source.rows.end(), parsed.begin(), parsed.end());
+        parsed.clear();
+      }
+    }
+    ::close(fd);
+  }
+}
+#else
+void read_socket(std::stop_token, live_source &, std::filesystem::path, char, std::vector<int>)
+{
+  fmt::println("live data is not supported on windows");
+}
+#endif
+} // namespace
+
+namespace explot
+{
+std::unique_ptr<live_source> open_live_source(const std::filesystem::path &path, char separator,
+                                              std::span<const int> indices)
+{
+  auto source = std::make_unique<live_source>();
+  source->reader = std::jthread(read_socket, std::ref(*source), path, separator,
+                                std::vector<int>(indices.begin(), indices.end()));
+  return source;
+}
+
+std::vector<float> take_rows(live_source &source)
+{
+  auto result = std::vector<float>();
+  auto lock = std::scoped_lock(source.mutex);
+  std::swap(result, source.rows);
+  return result;
+}
+} // namespace explot
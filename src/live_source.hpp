@@ -0,0 +1,27 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace explot
+{
+struct live_source
+{
+  std::mutex mutex;
+  std::vector<float> rows;
+  // declared last, so that the reader is stopped before the rows are destroyed
+  std::jthread reader;
+};
+
+// Connects to the UNIX domain socket at path and reads newline separated records in a background
+// thread. Only the columns in indices are kept. The connection is reestablished if it is lost.
+std::unique_ptr<live_source> open_live_source(const std::filesystem::path &path, char separator,
+                                              std::span<const int> indices);
+
+// Returns the rows that were received since the last call.
+std::vector<float> take_rows(live_source &source);
+} // namespace explot
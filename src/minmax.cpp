@@ -145,46 +145,30 @@ glm::vec2 minmax_z(gl_id vbo, uint32_t num_points, uint32_t point_size)
   return minmax(vbo, num_points, point_size, 2);
 }
 
-rect bounding_rect_2d(gl_id vbo, uint32_t num_points)
+rect bounding_rect(glm::vec2 bx, glm::vec2 by, glm::vec2 bz)
 {
-  auto bx = minmax_x(vbo, num_points, 2);
-  if (bx.y - bx.x < 1e-8)
-  {
-    bx.x -= 1.0f;
-    bx.y += 1.0f;
-  }
-  auto by = minmax_y(vbo, num_points, 2);
-  if (by.y - by.x < 1e-8)
+  for (auto b : {&bx, &by, &bz})
   {
-    by.x -= 1.0f;
-    by.y += 1.0f;
+    if (b->y - b->x < 1e-8)
+    {
+      b->x -= 1.0f;
+      b->y += 1.0f;
+    }
   }
-  // auto bz = minmax_z(d);
-  return rect{.lower_bounds = glm::vec3(bx.x, by.x, -1.0f),
-              .upper_bounds = glm::vec3(bx.y, by.y, 1.0f)};
+  return rect{.lower_bounds = glm::vec3(bx.x, by.x, bz.x),
+              .upper_bounds = glm::vec3(bx.y, by.y, bz.y)};
+}
+
+rect bounding_rect_2d(gl_id vbo, uint32_t num_points)
+{
+  return bounding_rect(minmax_x(vbo, num_points, 2), minmax_y(vbo, num_points, 2),
+                       glm::vec2(-1.0f, 1.0f));
 }
 
 rect bounding_rect_3d(gl_id vbo, uint32_t num_points, uint32_t point_size)
 {
-  auto bx = minmax_x(vbo, num_points, point_size);
-  if (bx.y - bx.x < 1e-8)
-  {
-    bx.x -= 1.0f;
-    bx.y += 1.0f;
-  }
-  auto by = minmax_y(vbo, num_points, point_size);
-  if (by.y - by.x < 1e-8)
-  {
-    by.x -= 1.0f;
-    by.y += 1.0f;
-  }
-  auto bz = minmax_z(vbo, num_points, point_size);
-  if (bz.y - bz.x < 1e-8)
-  {
-    bz.x -= 1.0f;
-    bz.y += 1.0f;
-  }
-  return rect{.lower_bounds = glm::vec3(bx.x, by.x, bz.x),
-              .upper_bounds = glm::vec3(bx.y, by.y, bz.y)};
+  return bounding_rect(minmax_x(vbo, num_points, point_size),
+                       minmax_y(vbo, num_points, point_size),
+                       minmax_z(vbo, num_points, point_size));
 }
 } // namespace explot
@@ -5,6 +5,9 @@
 
 namespace explot
 {
+// Bounds of every axis as (min, max). Axes without extent are widened, so that the rect has a
+// volume.
+rect bounding_rect(glm::vec2 bx, glm::vec2 by, glm::vec2 bz);
 rect bounding_rect_2d(gl_id vbo, uint32_t num_points);
 rect bounding_rect_3d(gl_id vbo, uint32_t num_points, uint32_t point_size);
 glm::vec2 minmax(gl_id dvbo, uint32_t num_points, uint32_t point_size, uint32_t offset);
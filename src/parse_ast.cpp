@@ -11,6 +11,9 @@
 #include <charconv>
 #include <ranges>
 #include "colors.hpp"
+#include "overload.hpp"
+#include <cctype>
+#include <limits>
 #include <numbers>
 
 namespace
@@ -53,6 +56,19 @@ struct parsed_decimal : lexy::token_production
       });
 };
 
+// literals of expressions keep the precision of the text for the evaluation in double precision
+struct parsed_literal : lexy::token_production
+{
+  static constexpr auto rule = dsl::capture(dsl::p<decimal>);
+  static constexpr auto value = lexy::callback<double>(
+      [](lexeme s)
+      {
+        double d = 0.0;
+        std::from_chars(s.data(), s.data() + s.size(), d);
+        return d;
+      });
+};
+
 struct decimal_integer
 {
   static constexpr auto rule = dsl::integer<uint32_t>(dsl::digits<>);
@@ -72,6 +88,15 @@ constexpr auto op_div = dsl::op<ast::binary_operator::div>(dsl::lit_c<'/'>);
 constexpr auto op_pow = dsl::op<ast::binary_operator::power>(LEXY_LIT("**"));
 constexpr auto op_unary_plus = dsl::op<ast::unary_operator::plus>(dsl::lit_c<'+'>);
 constexpr auto op_unary_minus = dsl::op<ast::unary_operator::minus>(dsl::lit_c<'-'>);
+constexpr auto op_not = dsl::op<ast::unary_operator::logical_not>(dsl::lit_c<'!'>);
+constexpr auto op_less = dsl::op<ast::binary_operator::less>(dsl::lit_c<'<'>);
+constexpr auto op_less_equal = dsl::op<ast::binary_operator::less_equal>(LEXY_LIT("<="));
+constexpr auto op_greater = dsl::op<ast::binary_operator::greater>(dsl::lit_c<'>'>);
+constexpr auto op_greater_equal = dsl::op<ast::binary_operator::greater_equal>(LEXY_LIT(">="));
+constexpr auto op_equal = dsl::op<ast::binary_operator::equal>(LEXY_LIT("=="));
+constexpr auto op_not_equal = dsl::op<ast::binary_operator::not_equal>(LEXY_LIT("!="));
+constexpr auto op_and = dsl::op<ast::binary_operator::logical_and>(LEXY_LIT("&&"));
+constexpr auto op_or = dsl::op<ast::binary_operator::logical_or>(LEXY_LIT("||"));
 
 struct expr_;
 
@@ -99,31 +124,42 @@ struct data_ref_
     static constexpr auto value = lexy::as_integer<int>;
   };
 
+  // column(i) with the variable of a for iteration becomes a data_ref when the iteration is
+  // expanded
   struct column_call
   {
     static constexpr auto rule =
-        LEXY_KEYWORD("column", kw_id) + dsl::parenthesized(dsl::integer<int>(dsl::digits<>));
-    static constexpr auto value = lexy::as_integer<int>;
+        LEXY_KEYWORD("column", kw_id)
+        + dsl::parenthesized(dsl::integer<int>(dsl::digits<>) | dsl::p<identifier>);
+    static constexpr auto value = lexy::callback<ast::expr>(
+        [](int idx) -> ast::expr { return ast::data_ref{idx}; },
+        [](std::string var) -> ast::expr
+        {
+          auto params = std::vector<ast::expr>();
+          params.push_back(ast::var_or_call{std::move(var), std::nullopt});
+          return ast::var_or_call{"column", std::move(params)};
+        });
   };
 
   static constexpr auto rule = dsl::peek(dsl::lit_c<'$'>) >> dsl::p<dollar_ref>
                                | dsl::peek_not(dsl::lit_c<'$'>) >> dsl::p<column_call>;
-  static constexpr auto value = lexy::construct<ast::data_ref>;
+  static constexpr auto value = lexy::callback<ast::expr>(
+      [](int idx) -> ast::expr { return ast::data_ref{idx}; }, lexy::forward<ast::expr>);
 };
 
 struct atom
 {
   static constexpr auto rule =
-      dsl::p<parsed_decimal> | dsl::parenthesized(dsl::recurse<expr_>)
+      dsl::p<parsed_literal> | dsl::parenthesized(dsl::recurse<expr_>)
       | dsl::peek_not(LEXY_KEYWORD("column", kw_id) | dsl::lit_c<'$'>) >> dsl::p<var_or_call_>
       | dsl::p<data_ref_>;
   static constexpr auto value = lexy::callback<ast::expr>(
-      [](float v) -> ast::expr { return ast::literal_expr{v}; }, lexy::forward<ast::expr>,
-      [](ast::var_or_call v) -> ast::expr { return std::move(v); },
-      [](ast::data_ref d) -> ast::expr { return d; });
+      [](double v) -> ast::expr { return ast::literal_expr{v}; }, lexy::forward<ast::expr>,
+      [](ast::var_or_call v) -> ast::expr { return std::move(v); });
 };
 
-struct expr_ : lexy::expression_production
+// the operators with the precedence of C
+struct operators_ : lexy::expression_production
 {
   static constexpr auto atom = dsl::p<r::atom>;
   static constexpr auto whitespace = dsl::ascii::space;
@@ -136,7 +172,7 @@ struct expr_ : lexy::expression_production
 
   struct infix_op : dsl::prefix_op
   {
-    static constexpr auto op = op_unary_plus / op_unary_minus;
+    static constexpr auto op = op_unary_plus / op_unary_minus / op_not;
     using operand = power_op;
   };
 
@@ -152,7 +188,31 @@ struct expr_ : lexy::expression_production
     using operand = mult_op;
   };
 
-  using operation = add_op;
+  struct compare_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_less_equal / op_less / op_greater_equal / op_greater;
+    using operand = add_op;
+  };
+
+  struct equal_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_equal / op_not_equal;
+    using operand = compare_op;
+  };
+
+  struct and_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_and;
+    using operand = equal_op;
+  };
+
+  struct or_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_or;
+    using operand = and_op;
+  };
+
+  using operation = or_op;
 
   static constexpr auto value = lexy::callback<ast::expr>(
       [](ast::unary_operator op, ast::expr operand) -> ast::expr
@@ -162,6 +222,20 @@ struct expr_ : lexy::expression_production
       [](ast::expr e) { return e; });
 };
 
+// The conditional operator binds weakest and is right associative, like in C. The ':' only
+// follows a '?', so it does not end columns of using.
+struct expr_
+{
+  static constexpr auto whitespace = dsl::ascii::space;
+  static constexpr auto rule =
+      dsl::p<operators_>
+      + dsl::if_(dsl::lit_c<'?'> >> dsl::recurse<expr_> + dsl::lit_c<':'> + dsl::recurse<expr_>);
+  static constexpr auto value = lexy::callback<ast::expr>(
+      [](ast::expr e) { return e; },
+      [](ast::expr condition, ast::expr then, ast::expr otherwise) -> ast::expr
+      { return ast::ternary_op{std::move(condition), std::move(then), std::move(otherwise)}; });
+};
+
 template <size_t N>
 struct nttp_str
 {
@@ -190,7 +264,8 @@ struct constant_builtin
 
 static constexpr auto constant_builtins =
     std::make_tuple(constant_builtin<"pi", std::numbers::pi_v<float>>{},
-                    constant_builtin<"e", std::numbers::e_v<float>>{});
+                    constant_builtin<"e", std::numbers::e_v<float>>{},
+                    constant_builtin<"NaN", std::numeric_limits<float>::quiet_NaN()>{});
 
 template <size_t I>
 using constant_builtin_t = std::remove_cvref_t<decltype(std::get<I>(constant_builtins))>;
@@ -212,25 +287,38 @@ std::optional<float> find_constant_(std::string_view name, std::index_sequence<I
   }
 }
 
-template <nttp_str name_, float (*func_)(float)>
+template <nttp_str name_, float (*func_)(float), double (*func_fp64_)(double),
+          unary_kernel kernel_>
 struct unary_builtin
 {
   static constexpr auto name = name_;
   static constexpr auto func = func_;
+  static constexpr auto func_fp64 = func_fp64_;
+  static constexpr auto kernel = kernel_;
 };
 
-static constexpr auto unary_builtins =
-    std::make_tuple(unary_builtin<"abs", std::abs>{}, unary_builtin<"acos", std::acos>{},
-                    unary_builtin<"acosh", std::acosh>{}, unary_builtin<"asin", std::asin>{},
-                    unary_builtin<"asinh", std::asinh>{}, unary_builtin<"atan", std::atan>{},
-                    unary_builtin<"atanh", std::atanh>{}, unary_builtin<"ceil", std::ceil>{},
-                    unary_builtin<"cos", std::cos>{}, unary_builtin<"cosh", std::cosh>{},
-                    unary_builtin<"exp", std::exp>{}, unary_builtin<"floor", std::floor>{},
-                    unary_builtin<"log", std::log>{}, unary_builtin<"log10", std::log10>{},
-                    unary_builtin<"sgn", [](float v) { return std::copysign(1.0f, v); }>{},
-                    unary_builtin<"sin", std::sin>{}, unary_builtin<"sinh", std::sinh>{},
-                    unary_builtin<"sqrt", std::sqrt>{}, unary_builtin<"tan", std::tan>{},
-                    unary_builtin<"tanh", std::tanh>{});
+static constexpr auto unary_builtins = std::make_tuple(
+    unary_builtin<"abs", std::abs, std::abs, batch_abs>{},
+    unary_builtin<"acos", std::acos, std::acos, batch_acos>{},
+    unary_builtin<"acosh", std::acosh, std::acosh, batch_acosh>{},
+    unary_builtin<"asin", std::asin, std::asin, batch_asin>{},
+    unary_builtin<"asinh", std::asinh, std::asinh, batch_asinh>{},
+    unary_builtin<"atan", std::atan, std::atan, batch_atan>{},
+    unary_builtin<"atanh", std::atanh, std::atanh, batch_atanh>{},
+    unary_builtin<"ceil", std::ceil, std::ceil, batch_ceil>{},
+    unary_builtin<"cos", std::cos, std::cos, batch_cos>{},
+    unary_builtin<"cosh", std::cosh, std::cosh, batch_cosh>{},
+    unary_builtin<"exp", std::exp, std::exp, batch_exp>{},
+    unary_builtin<"floor", std::floor, std::floor, batch_floor>{},
+    unary_builtin<"log", std::log, std::log, batch_log>{},
+    unary_builtin<"log10", std::log10, std::log10, batch_log10>{},
+    unary_builtin<"sgn", [](float v) { return std::copysign(1.0f, v); },
+                  [](double v) { return std::copysign(1.0, v); }, batch_sgn>{},
+    unary_builtin<"sin", std::sin, std::sin, batch_sin>{},
+    unary_builtin<"sinh", std::sinh, std::sinh, batch_sinh>{},
+    unary_builtin<"sqrt", std::sqrt, std::sqrt, batch_sqrt>{},
+    unary_builtin<"tan", std::tan, std::tan, batch_tan>{},
+    unary_builtin<"tanh", std::tanh, std::tanh, batch_tanh>{});
 
 template <size_t i>
 using unary_builtin_t = std::remove_cvref_t<decltype(std::get<i>(unary_builtins))>;
@@ -253,15 +341,38 @@ std::optional<std::string_view> find_unary_(std::string_view name, std::index_se
   }
 }
 
-template <nttp_str name_, float (*func_)(float, float)>
+std::optional<unary_function> find_unary_function_(std::string_view, std::index_sequence<>)
+{
+  return std::nullopt;
+}
+
+template <size_t I, size_t... Is>
+std::optional<unary_function> find_unary_function_(std::string_view name,
+                                                   std::index_sequence<I, Is...>)
+{
+  if (name == unary_builtin_t<I>::name.as_sv())
+  {
+    return unary_builtin_t<I>::func;
+  }
+  else
+  {
+    return find_unary_function_(name, std::index_sequence<Is...>{});
+  }
+}
+
+template <nttp_str name_, float (*func_)(float, float), double (*func_fp64_)(double, double),
+          binary_kernel kernel_>
 struct binary_builtin
 {
   static constexpr auto name = name_;
   static constexpr auto func = func_;
+  static constexpr auto func_fp64 = func_fp64_;
+  static constexpr auto kernel = kernel_;
 };
 
 static constexpr auto binary_builtins =
-    std::make_tuple(binary_builtin<"atan2", std::atan2>{}, binary_builtin<"pow", std::pow>{});
+    std::make_tuple(binary_builtin<"atan2", std::atan2, std::atan2, batch_atan2>{},
+                    binary_builtin<"pow", std::pow, std::pow, batch_pow>{});
 
 template <size_t I>
 using binary_builtin_t = std::remove_cvref_t<decltype(std::get<I>(binary_builtins))>;
@@ -285,6 +396,103 @@ std::optional<std::string_view> find_binary_builtin(std::string_view name,
   }
 }
 
+std::optional<binary_function> find_binary_function_(std::string_view, std::index_sequence<>)
+{
+  return std::nullopt;
+}
+
+template <size_t I, size_t... Is>
+std::optional<binary_function> find_binary_function_(std::string_view name,
+                                                     std::index_sequence<I, Is...>)
+{
+  if (name == binary_builtin_t<I>::name.as_sv())
+  {
+    return binary_builtin_t<I>::func;
+  }
+  else
+  {
+    return find_binary_function_(name, std::index_sequence<Is...>{});
+  }
+}
+
+std::optional<unary_function_fp64> find_unary_function_fp64_(std::string_view,
+                                                             std::index_sequence<>)
+{
+  return std::nullopt;
+}
+
+template <size_t I, size_t... Is>
+std::optional<unary_function_fp64> find_unary_function_fp64_(std::string_view name,
+                                                             std::index_sequence<I, Is...>)
+{
+  if (name == unary_builtin_t<I>::name.as_sv())
+  {
+    return unary_builtin_t<I>::func_fp64;
+  }
+  else
+  {
+    return find_unary_function_fp64_(name, std::index_sequence<Is...>{});
+  }
+}
+
+std::optional<binary_function_fp64> find_binary_function_fp64_(std::string_view,
+                                                               std::index_sequence<>)
+{
+  return std::nullopt;
+}
+
+template <size_t I, size_t... Is>
+std::optional<binary_function_fp64> find_binary_function_fp64_(std::string_view name,
+                                                               std::index_sequence<I, Is...>)
+{
+  if (name == binary_builtin_t<I>::name.as_sv())
+  {
+    return binary_builtin_t<I>::func_fp64;
+  }
+  else
+  {
+    return find_binary_function_fp64_(name, std::index_sequence<Is...>{});
+  }
+}
+
+std::optional<unary_kernel> find_unary_kernel_(std::string_view, std::index_sequence<>)
+{
+  return std::nullopt;
+}
+
+template <size_t I, size_t... Is>
+std::optional<unary_kernel> find_unary_kernel_(std::string_view name,
+                                               std::index_sequence<I, Is...>)
+{
+  if (name == unary_builtin_t<I>::name.as_sv())
+  {
+    return unary_builtin_t<I>::kernel;
+  }
+  else
+  {
+    return find_unary_kernel_(name, std::index_sequence<Is...>{});
+  }
+}
+
+std::optional<binary_kernel> find_binary_kernel_(std::string_view, std::index_sequence<>)
+{
+  return std::nullopt;
+}
+
+template <size_t I, size_t... Is>
+std::optional<binary_kernel> find_binary_kernel_(std::string_view name,
+                                                 std::index_sequence<I, Is...>)
+{
+  if (name == binary_builtin_t<I>::name.as_sv())
+  {
+    return binary_builtin_t<I>::kernel;
+  }
+  else
+  {
+    return find_binary_kernel_(name, std::index_sequence<Is...>{});
+  }
+}
+
 template <template <size_t> typename parser, size_t... Is>
 struct disjunction_
 {
@@ -361,7 +569,7 @@ struct const_expr_ : lexy::expression_production
 
   struct infix_op : dsl::prefix_op
   {
-    static constexpr auto op = op_unary_plus / op_unary_minus;
+    static constexpr auto op = op_unary_plus / op_unary_minus / op_not;
     using operand = power_op;
   };
 
@@ -377,8 +585,33 @@ struct const_expr_ : lexy::expression_production
     using operand = mult_op;
   };
 
-  using operation = add_op;
+  struct compare_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_less_equal / op_less / op_greater_equal / op_greater;
+    using operand = add_op;
+  };
+
+  struct equal_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_equal / op_not_equal;
+    using operand = compare_op;
+  };
 
+  struct and_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_and;
+    using operand = equal_op;
+  };
+
+  struct or_op : dsl::infix_op_left
+  {
+    static constexpr auto op = op_or;
+    using operand = and_op;
+  };
+
+  using operation = or_op;
+
+  // comparisons and logical operators are 1 if true and 0 if false
   static constexpr auto value = lexy::callback<float>(
       [](ast::unary_operator op, float v)
       {
@@ -388,6 +621,8 @@ struct const_expr_ : lexy::expression_production
           return v;
         case ast::unary_operator::minus:
           return -v;
+        case ast::unary_operator::logical_not:
+          return v == 0.0f ? 1.0f : 0.0f;
         }
       },
       [](float lhs, ast::binary_operator op, float rhs)
@@ -404,6 +639,22 @@ struct const_expr_ : lexy::expression_production
           return lhs / rhs;
         case ast::binary_operator::power:
           return std::pow(lhs, rhs);
+        case ast::binary_operator::less:
+          return lhs < rhs ? 1.0f : 0.0f;
+        case ast::binary_operator::less_equal:
+          return lhs <= rhs ? 1.0f : 0.0f;
+        case ast::binary_operator::greater:
+          return lhs > rhs ? 1.0f : 0.0f;
+        case ast::binary_operator::greater_equal:
+          return lhs >= rhs ? 1.0f : 0.0f;
+        case ast::binary_operator::equal:
+          return lhs == rhs ? 1.0f : 0.0f;
+        case ast::binary_operator::not_equal:
+          return lhs != rhs ? 1.0f : 0.0f;
+        case ast::binary_operator::logical_and:
+          return lhs != 0.0f && rhs != 0.0f ? 1.0f : 0.0f;
+        case ast::binary_operator::logical_or:
+          return lhs != 0.0f || rhs != 0.0f ? 1.0f : 0.0f;
         }
       },
       [](float e) { return e; });
@@ -634,10 +885,16 @@ struct usingp
 {
   struct coord
   {
-    static constexpr auto rule =
-        dsl::parenthesized(dsl::p<expr_>) | dsl::integer<int>(dsl::digits<>);
+    static constexpr auto rule = dsl::parenthesized(dsl::p<expr_>)
+                                 | dsl::integer<int>(dsl::digits<>) | dsl::p<identifier>;
     static constexpr auto value = lexy::callback<ast::expr>(
-        lexy::forward<ast::expr>, [](int idx) -> ast::expr { return ast::data_ref{idx}; });
+        lexy::forward<ast::expr>, [](int idx) -> ast::expr { return ast::data_ref{idx}; },
+        [](std::string var) -> ast::expr
+        {
+          auto params = std::vector<ast::expr>();
+          params.push_back(ast::var_or_call{std::move(var), std::nullopt});
+          return ast::var_or_call{"column", std::move(params)};
+        });
   };
   static constexpr auto whitespace = dsl::ascii::space;
   static constexpr auto rule =
@@ -659,41 +916,315 @@ struct title
   static constexpr auto value = lexy::forward<std::string>;
 };
 
-struct csv_data_
+struct live
 {
+  static constexpr auto whitespace = dsl::ascii::space;
   static constexpr auto rule =
-      dsl::p<string> + dsl::opt(LEXY_KEYWORD("matrix", kw_id)) + dsl::p<usingp>;
+      LEXY_KEYWORD("live", kw_id) >> dsl::opt(dsl::peek(dsl::digit<>) >> dsl::p<decimal_integer>);
+  static constexpr auto value = lexy::callback<ast::live_options>(
+      [](lexy::nullopt) { return ast::live_options{std::nullopt}; },
+      [](uint32_t window) { return ast::live_options{window}; });
+};
+
+struct csv_path
+{
+  static constexpr auto rule = dsl::p<string> | dsl::p<identifier>;
   static constexpr auto value = lexy::callback<ast::csv_data>(
-      [](std::string path, lexy::nullopt, std::vector<ast::expr> exprs)
-      { return ast::csv_data{std::move(path), std::move(exprs), false}; },
-      [](std::string path, std::vector<ast::expr> exprs)
-      { return ast::csv_data{std::move(path), std::move(exprs), true}; });
+      [](std::string path) { return ast::csv_data{.path = std::move(path)}; },
+      [](std::string var) { return ast::csv_data{.path_var = std::move(var)}; });
+};
+
+struct csv_data_
+{
+  static constexpr auto rule = dsl::p<csv_path> + dsl::opt(LEXY_KEYWORD("matrix", kw_id))
+                               + dsl::p<usingp> + dsl::opt(dsl::p<live>);
+  static constexpr auto value = lexy::callback<ast::csv_data>(
+      [](ast::csv_data d, lexy::nullopt, std::vector<ast::expr> exprs, lexy::nullopt)
+      {
+        d.expressions = std::move(exprs);
+        return d;
+      },
+      [](ast::csv_data d, std::vector<ast::expr> exprs, lexy::nullopt)
+      {
+        d.expressions = std::move(exprs);
+        d.matrix = true;
+        return d;
+      },
+      [](ast::csv_data d, lexy::nullopt, std::vector<ast::expr> exprs, ast::live_options l)
+      {
+        d.expressions = std::move(exprs);
+        d.live = l;
+        return d;
+      },
+      [](ast::csv_data d, std::vector<ast::expr> exprs, ast::live_options l)
+      {
+        d.expressions = std::move(exprs);
+        d.matrix = true;
+        d.live = l;
+        return d;
+      });
 };
 
+// a datafile whose path is a variable, like f in plot for [f in "a.csv b.csv"] f using 1:2
+constexpr auto csv_path_var = dsl::peek(
+    identifier::rule + dsl::whitespace(dsl::ascii::space)
+    + (LEXY_KEYWORD("using", kw_id) | LEXY_KEYWORD("matrix", kw_id)));
+
+constexpr auto max_iterations = int64_t{10'000};
+
+// counted in 64 bits, so that neither the count nor the variable overflow
+constexpr int64_t num_iterations(const ast::iteration_range &r)
+{
+  const auto span = int64_t{r.last} - int64_t{r.first};
+  return span == 0 || (span > 0) == (r.step > 0) ? span / r.step + 1 : 0;
+}
+
+struct iteration
+{
+  static constexpr auto whitespace = dsl::ascii::space;
+
+  struct words
+  {
+    static constexpr auto rule = dsl::p<string>;
+    static constexpr auto value = lexy::callback<std::vector<std::string>>(
+        [](const std::string &s)
+        {
+          auto result = std::vector<std::string>();
+          for (auto &&w : std::views::split(s, ' '))
+          {
+            if (!std::ranges::empty(w))
+            {
+              result.emplace_back(std::ranges::begin(w), std::ranges::end(w));
+            }
+          }
+          return result;
+        });
+  };
+
+  struct range
+  {
+    static constexpr auto whitespace = dsl::ascii::space;
+    static constexpr auto rule = dsl::p<signed_integer> + dsl::colon + dsl::p<signed_integer>
+                                 + dsl::opt(dsl::colon >> dsl::p<signed_integer>);
+    static constexpr auto value = lexy::callback<ast::iteration_range>(
+        [](int first, int last, lexy::nullopt) { return ast::iteration_range{first, last, 1}; },
+        [](int first, int last, int step) { return ast::iteration_range{first, last, step}; });
+  };
+
+  // A range with step 0 would never end and every iteration copies the graph, so the number of
+  // iterations is limited.
+  struct checked_range : lexy::scan_production<ast::iteration_range>
+  {
+    struct zero_step
+    {
+    };
+
+    struct too_many_iterations
+    {
+    };
+
+    template <typename context, typename reader>
+    static constexpr scan_result scan(lexy::rule_scanner<context, reader> &scanner)
+    {
+      auto result = scanner.parse(range{});
+      if (!scanner)
+      {
+        return lexy::scan_failed;
+      }
+      if (result.value().step == 0)
+      {
+        scanner.error(zero_step{}, scanner.begin(), scanner.position());
+        return lexy::scan_failed;
+      }
+      if (num_iterations(result.value()) > max_iterations)
+      {
+        scanner.error(too_many_iterations{}, scanner.begin(), scanner.position());
+        return lexy::scan_failed;
+      }
+      return result.value();
+    }
+  };
+
+  static constexpr auto rule =
+      LEXY_KEYWORD("for", kw_id)
+      >> dsl::square_bracketed(dsl::p<identifier>
+                               + (LEXY_KEYWORD("in", kw_id) >> dsl::p<words>
+                                  | dsl::lit_c<'='> >> dsl::p<checked_range>));
+  static constexpr auto value = lexy::callback<ast::iteration>(
+      [](std::string var, std::vector<std::string> words)
+      { return ast::iteration{std::move(var), std::move(words)}; },
+      [](std::string var, ast::iteration_range r)
+      { return ast::iteration{std::move(var), r}; });
+};
+
+// replaces the variable of an iteration by value. column(variable) becomes a data_ref.
+ast::expr substitute(ast::expr e, std::string_view var, float value)
+{
+  return std::visit(
+      overload(
+          [&](box<ast::unary_op> o) -> ast::expr
+          {
+            o->operand = substitute(std::move(o->operand), var, value);
+            return o;
+          },
+          [&](box<ast::binary_op> o) -> ast::expr
+          {
+            o->lhs = substitute(std::move(o->lhs), var, value);
+            o->rhs = substitute(std::move(o->rhs), var, value);
+            return o;
+          },
+          [&](box<ast::var_or_call> v) -> ast::expr
+          {
+            if (!v->params)
+            {
+              return v->name == var ? ast::expr(ast::literal_expr{value}) : ast::expr(v);
+            }
+            for (auto &p : *v->params)
+            {
+              p = substitute(std::move(p), var, value);
+            }
+            if (v->name == "column" && v->params->size() == 1
+                && std::holds_alternative<ast::literal_expr>(v->params->front()))
+            {
+              return ast::data_ref{
+                  static_cast<int>(std::get<ast::literal_expr>(v->params->front()).value)};
+            }
+            return v;
+          },
+          [](auto other) -> ast::expr { return other; }),
+      std::move(e));
+}
+
+// replaces var by value where it is a whole word in text
+std::string substitute(std::string_view text, std::string_view var, std::string_view value)
+{
+  auto is_word_char = [](char c)
+  { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+  auto result = std::string();
+  auto pos = 0uz;
+  while (pos < text.size())
+  {
+    auto found = text.find(var, pos);
+    if (found == std::string_view::npos)
+    {
+      break;
+    }
+    auto end = found + var.size();
+    result.append(text.substr(pos, found - pos));
+    if ((found > 0 && is_word_char(text[found - 1]))
+        || (end < text.size() && is_word_char(text[end])))
+    {
+      result.append(var);
+    }
+    else
+    {
+      result.append(value);
+    }
+    pos = end;
+  }
+  result.append(text.substr(std::min(pos, text.size())));
+  return result;
+}
+
+struct for_clause
+{
+  static constexpr auto rule = dsl::opt(dsl::p<iteration>);
+  static constexpr auto value = lexy::callback<std::optional<ast::iteration>>(
+      [](lexy::nullopt) { return std::optional<ast::iteration>(); },
+      [](ast::iteration it) { return std::optional(std::move(it)); });
+};
+
+template <typename Graph>
+std::vector<Graph> expand(std::optional<ast::iteration> it, Graph g, bool auto_title)
+{
+  auto result = std::vector<Graph>();
+  if (!it)
+  {
+    result.push_back(std::move(g));
+    return result;
+  }
+
+  std::visit(
+      overload(
+          [&](const std::vector<std::string> &words)
+          {
+            for (const auto &w : words)
+            {
+              auto h = g;
+              // a lone variable is a datafile without using
+              if (auto exprs = std::get_if<std::vector<ast::expr>>(&h.data);
+                  exprs && exprs->size() == 1)
+              {
+                auto v = std::get_if<box<ast::var_or_call>>(&exprs->front());
+                if (v && !(*v)->params && (*v)->name == it->variable)
+                {
+                  h.data = ast::csv_data{.path_var = it->variable};
+                }
+              }
+              if (auto d = std::get_if<ast::csv_data>(&h.data);
+                  d && d->path_var == it->variable)
+              {
+                d->path = w;
+                d->path_var.reset();
+              }
+              if (auto_title)
+              {
+                h.title = substitute(h.title, it->variable, "\"" + w + "\"");
+              }
+              result.push_back(std::move(h));
+            }
+          },
+          [&](const ast::iteration_range &r)
+          {
+            for (auto k = int64_t{0}; k < num_iterations(r); ++k)
+            {
+              const auto i = r.first + k * r.step;
+              auto h = g;
+              auto &exprs = std::holds_alternative<ast::csv_data>(h.data)
+                                ? std::get<ast::csv_data>(h.data).expressions
+                                : std::get<std::vector<ast::expr>>(h.data);
+              for (auto &e : exprs)
+              {
+                e = substitute(std::move(e), it->variable, static_cast<float>(i));
+              }
+              if (auto_title)
+              {
+                h.title = substitute(h.title, it->variable, std::to_string(i));
+              }
+              result.push_back(std::move(h));
+            }
+          }),
+      it->values);
+  return result;
+}
+
 constexpr auto graph_list_2d = lexy::fold_inplace<std::vector<ast::graph_desc_2d>>(
     [] { return std::vector<ast::graph_desc_2d>(); },
-    [](std::vector<ast::graph_desc_2d> &gs, ast::graph_desc_2d g)
+    [](std::vector<ast::graph_desc_2d> &gs, std::vector<ast::graph_desc_2d> expanded)
     {
-      if (std::holds_alternative<ast::csv_data>(g.data))
+      for (auto &g : expanded)
       {
-        auto &d = std::get<ast::csv_data>(g.data);
-        if (d.path.empty())
+        if (std::holds_alternative<ast::csv_data>(g.data))
         {
-          auto rgs = std::views::reverse(gs);
-          auto last_with_path =
-              std::ranges::find_if(rgs,
-                                   [](const ast::graph_desc_2d &h)
-                                   {
-                                     return std::holds_alternative<ast::csv_data>(h.data)
-                                            && !std::get<ast::csv_data>(h.data).path.empty();
-                                   });
-          if (last_with_path != rgs.end())
+          auto &d = std::get<ast::csv_data>(g.data);
+          if (d.path.empty() && !d.path_var)
           {
-            d.path = std::get<ast::csv_data>(last_with_path->data).path;
+            auto rgs = std::views::reverse(gs);
+            auto last_with_path =
+                std::ranges::find_if(rgs,
+                                     [](const ast::graph_desc_2d &h)
+                                     {
+                                       return std::holds_alternative<ast::csv_data>(h.data)
+                                              && !std::get<ast::csv_data>(h.data).path.empty();
+                                     });
+            if (last_with_path != rgs.end())
+            {
+              d.path = std::get<ast::csv_data>(last_with_path->data).path;
+            }
           }
         }
+        gs.push_back(std::move(g));
       }
-      gs.push_back(std::move(g));
     });
 
 struct expr_list
@@ -709,7 +1240,8 @@ struct plot
   struct data
   {
     static constexpr auto rule =
-        dsl::peek(str_delim) >> dsl::p<csv_data_> | dsl::else_ >> dsl::p<expr_list>;
+        dsl::peek(str_delim) >> dsl::p<csv_data_> | csv_path_var >> dsl::p<csv_data_>
+        | dsl::else_ >> dsl::p<expr_list>;
     static constexpr auto value = lexy::construct<ast::data_source_2d>;
   };
 
@@ -730,12 +1262,15 @@ struct plot
           [](ast::graph_desc_2d &g, const ast::line_type_desc &lt) { g.line_type = lt; });
     };
 
-    static constexpr auto rule = dsl::position + dsl::p<data> + dsl::position + dsl::p<directives>;
-    static constexpr auto value = lexy::callback<ast::graph_desc_2d>(
-        [](const char *s, ast::data_source_2d d, const char *e, ast::graph_desc_2d g)
+    static constexpr auto rule = dsl::p<for_clause> + dsl::position + dsl::p<data> + dsl::position
+                                 + dsl::p<directives>;
+    static constexpr auto value = lexy::callback<std::vector<ast::graph_desc_2d>>(
+        [](std::optional<ast::iteration> it, const char *s, ast::data_source_2d d, const char *e,
+           ast::graph_desc_2d g)
         {
+          const auto auto_title = g.title.empty();
           g.data = d;
-          if (g.title.empty())
+          if (auto_title)
           {
             while (s != e && std::isspace(*s))
             {
@@ -747,7 +1282,7 @@ struct plot
             }
             g.title = std::string(s, e);
           }
-          return g;
+          return expand(std::move(it), std::move(g), auto_title);
         });
   };
 
@@ -777,28 +1312,31 @@ struct plot
 
 constexpr auto graph_list_3d = lexy::fold_inplace<std::vector<ast::graph_desc_3d>>(
     [] { return std::vector<ast::graph_desc_3d>(); },
-    [](std::vector<ast::graph_desc_3d> &gs, ast::graph_desc_3d g)
+    [](std::vector<ast::graph_desc_3d> &gs, std::vector<ast::graph_desc_3d> expanded)
     {
-      if (std::holds_alternative<ast::csv_data>(g.data))
+      for (auto &g : expanded)
       {
-        auto &d = std::get<ast::csv_data>(g.data);
-        if (d.path.empty())
+        if (std::holds_alternative<ast::csv_data>(g.data))
         {
-          auto rgs = std::views::reverse(gs);
-          auto last_with_path =
-              std::ranges::find_if(rgs,
-                                   [](const ast::graph_desc_3d &h)
-                                   {
-                                     return std::holds_alternative<ast::csv_data>(h.data)
-                                            && !std::get<ast::csv_data>(h.data).path.empty();
-                                   });
-          if (last_with_path != rgs.end())
+          auto &d = std::get<ast::csv_data>(g.data);
+          if (d.path.empty() && !d.path_var)
           {
-            d.path = std::get<ast::csv_data>(last_with_path->data).path;
+            auto rgs = std::views::reverse(gs);
+            auto last_with_path =
+                std::ranges::find_if(rgs,
+                                     [](const ast::graph_desc_3d &h)
+                                     {
+                                       return std::holds_alternative<ast::csv_data>(h.data)
+                                              && !std::get<ast::csv_data>(h.data).path.empty();
+                                     });
+            if (last_with_path != rgs.end())
+            {
+              d.path = std::get<ast::csv_data>(last_with_path->data).path;
+            }
           }
         }
+        gs.push_back(std::move(g));
       }
-      gs.push_back(std::move(g));
     });
 
 struct splot
@@ -808,7 +1346,8 @@ struct splot
   struct data
   {
     static constexpr auto rule =
-        dsl::peek(str_delim) >> dsl::p<csv_data_> | dsl::else_ >> dsl::p<expr_list>;
+        dsl::peek(str_delim) >> dsl::p<csv_data_> | csv_path_var >> dsl::p<csv_data_>
+        | dsl::else_ >> dsl::p<expr_list>;
     static constexpr auto value = lexy::construct<ast::data_source_3d>;
   };
 
@@ -828,11 +1367,14 @@ struct splot
           [](ast::graph_desc_3d &g, const ast::line_type_desc &lt) { g.line_type = lt; });
     };
 
-    static constexpr auto rule = dsl::position + dsl::p<data> + dsl::position + dsl::p<directives>;
-    static constexpr auto value = lexy::callback<ast::graph_desc_3d>(
-        [](const char *s, ast::data_source_3d d, const char *e, ast::graph_desc_3d g)
+    static constexpr auto rule = dsl::p<for_clause> + dsl::position + dsl::p<data> + dsl::position
+                                 + dsl::p<directives>;
+    static constexpr auto value = lexy::callback<std::vector<ast::graph_desc_3d>>(
+        [](std::optional<ast::iteration> it, const char *s, ast::data_source_3d d, const char *e,
+           ast::graph_desc_3d g)
         {
-          if (g.title.empty())
+          const auto auto_title = g.title.empty();
+          if (auto_title)
           {
             while (s != e && std::isspace(*s))
             {
@@ -845,7 +1387,7 @@ struct splot
             g.title = std::string(s, e);
           }
           g.data = std::move(d);
-          return g;
+          return expand(std::move(it), std::move(g), auto_title);
         });
   };
 
@@ -889,14 +1431,21 @@ struct settings_parser
       | (LEXY_KEYWORD("xdata", kw_id) >> dsl::p<parser<settings_id::xdata>>)
       | (LEXY_KEYWORD("isosamples", kw_id) >> dsl::p<parser<settings_id::isosamples>>)
       | (LEXY_KEYWORD("datafile", kw_id)
-         >> (LEXY_KEYWORD("separator", kw_id) >> dsl::p<parser<settings_id::datafile_separator>>))
+         >> ((LEXY_KEYWORD("separator", kw_id) >> dsl::p<parser<settings_id::datafile_separator>>)
+             | (LEXY_KEYWORD("engine", kw_id) >> dsl::p<parser<settings_id::datafile_engine>>)
+             | (LEXY_KEYWORD("cache", kw_id) >> dsl::p<parser<settings_id::datafile_cache>>)))
       | (LEXY_KEYWORD("xrange", kw_id) >> dsl::p<parser<settings_id::xrange>>)
       | (LEXY_KEYWORD("parametric", kw_id) >> dsl::p<parser<settings_id::parametric>>)
       | (LEXY_KEYWORD("timefmt", kw_id) >> dsl::p<parser<settings_id::timefmt>>)
       | (LEXY_KEYWORD("hidden3d", kw_id) >> dsl::p<parser<settings_id::hidden3d>>)
       | (LEXY_KEYWORD("palette", kw_id) >> (LEXY_KEYWORD("rgbformulae", kw_id)
                                             >> dsl::p<parser<settings_id::pallette_rgbformulae>>))
-      | (LEXY_KEYWORD("multiplot", kw_id) >> dsl::p<parser<settings_id::multiplot>>);
+      | (LEXY_KEYWORD("multiplot", kw_id) >> dsl::p<parser<settings_id::multiplot>>)
+      | (LEXY_KEYWORD("evaluation", kw_id)
+         >> ((LEXY_KEYWORD("budget", kw_id) >> dsl::p<parser<settings_id::evaluation_budget>>)
+             | dsl::else_ >> dsl::p<parser<settings_id::evaluation>>))
+      | (LEXY_KEYWORD("sampling", kw_id) >> dsl::p<parser<settings_id::sampling>>)
+      | (LEXY_KEYWORD("precision", kw_id) >> dsl::p<parser<settings_id::precision>>);
   static constexpr auto value = lexy::construct<enum_sum_t<settings_id, vv, all_settings>>;
 };
 
@@ -963,6 +1512,89 @@ struct set
         [](lexy::nullopt) { return data_type::normal; }, [](data_type t) { return t; });
   };
 
+  template <>
+  struct value_parser<datafile_engine>
+  {
+    static constexpr auto rule = dsl::capture(LEXY_KEYWORD("cpu", kw_id))
+                                 | dsl::capture(LEXY_KEYWORD("gpu", kw_id));
+    static constexpr auto value = lexy::callback<datafile_engine>(
+        [](const auto &s)
+        {
+          return std::string(s.begin(), s.end()) == "gpu" ? datafile_engine::gpu
+                                                           : datafile_engine::cpu;
+        });
+  };
+
+  template <>
+  struct value_parser<evaluation_setting>
+  {
+    struct feedback
+    {
+      static constexpr auto rule = LEXY_KEYWORD("feedback", kw_id);
+      static constexpr auto value =
+          lexy::constant(evaluation_setting{.engine = expression_engine::transform_feedback});
+    };
+
+    struct compute
+    {
+      static constexpr auto rule =
+          LEXY_KEYWORD("compute", kw_id) >> dsl::opt(dsl::p<decimal_integer>);
+      static constexpr auto value = lexy::callback<evaluation_setting>(
+          [](lexy::nullopt) { return evaluation_setting{.engine = expression_engine::compute}; },
+          [](uint32_t size)
+          {
+            return evaluation_setting{.engine = expression_engine::compute,
+                                      .workgroup_size = size};
+          });
+    };
+
+    static constexpr auto rule = dsl::p<feedback> | dsl::p<compute>;
+    static constexpr auto value = lexy::forward<evaluation_setting>;
+  };
+
+  template <>
+  struct value_parser<uint32_t>
+  {
+    static constexpr auto rule = dsl::p<decimal_integer>;
+    static constexpr auto value = lexy::forward<uint32_t>;
+  };
+
+  template <>
+  struct value_parser<precision_setting>
+  {
+    static constexpr auto rule = dsl::capture(LEXY_KEYWORD("single", kw_id))
+                                 | dsl::capture(LEXY_KEYWORD("double", kw_id));
+    static constexpr auto value = lexy::callback<precision_setting>(
+        [](const auto &s)
+        {
+          return std::string(s.begin(), s.end()) == "double" ? precision_setting::fp64
+                                                              : precision_setting::single;
+        });
+  };
+
+  template <>
+  struct value_parser<sampling_setting>
+  {
+    struct uniform
+    {
+      static constexpr auto rule = LEXY_KEYWORD("uniform", kw_id);
+      static constexpr auto value = lexy::constant(sampling_setting{});
+    };
+
+    struct adaptive
+    {
+      static constexpr auto rule =
+          LEXY_KEYWORD("adaptive", kw_id) >> dsl::opt(dsl::p<decimal_integer>);
+      static constexpr auto value = lexy::callback<sampling_setting>(
+          [](lexy::nullopt) { return sampling_setting{.adaptive = true}; },
+          [](uint32_t max_points)
+          { return sampling_setting{.adaptive = true, .max_points = max_points}; });
+    };
+
+    static constexpr auto rule = dsl::p<uniform> | dsl::p<adaptive>;
+    static constexpr auto value = lexy::forward<sampling_setting>;
+  };
+
   template <>
   struct value_parser<bool>
   {
@@ -1051,6 +1683,25 @@ struct load
                                     std::filesystem::path> >> lexy::construct<load_command>;
 };
 
+struct bind
+{
+  static constexpr auto rule = dsl::p<identifier> + dsl::p<range>;
+  static constexpr auto value = lexy::construct<ast::bind_command>;
+};
+
+struct animate
+{
+  static constexpr auto rule = dsl::p<identifier> + LEXY_KEYWORD("from", kw_id)
+                               + dsl::p<const_expr_> + LEXY_KEYWORD("to", kw_id)
+                               + dsl::p<const_expr_>
+                               + dsl::opt(LEXY_KEYWORD("fps", kw_id) >> dsl::p<const_expr_>);
+  static constexpr auto value = lexy::callback<animate_command>(
+      [](std::string name, float from, float to, lexy::nullopt)
+      { return animate_command{std::move(name), from, to, 30.0f}; },
+      [](std::string name, float from, float to, float fps)
+      { return animate_command{std::move(name), from, to, fps}; });
+};
+
 struct command_ast
 {
   static constexpr auto whitespace = dsl::ascii::space;
@@ -1059,7 +1710,9 @@ struct command_ast
       | dsl::keyword<"set">(kw_id) >> dsl::p<set> | dsl::keyword<"unset">(kw_id) >> dsl::p<unset>
       | dsl::keyword<"show">(kw_id) >> dsl::p<show> | dsl::keyword<"cd">(kw_id) >> dsl::p<cd>
       | dsl::keyword<"pwd">(kw_id) >> dsl::p<pwd> | dsl::keyword<"quit">(kw_id) >> dsl::p<quit>
-      | dsl::keyword<"load">(kw_id) >> dsl::p<load> | dsl::else_ >> dsl::p<user_definition>;
+      | dsl::keyword<"load">(kw_id) >> dsl::p<load> | dsl::keyword<"bind">(kw_id) >> dsl::p<bind>
+      | dsl::keyword<"animate">(kw_id) >> dsl::p<animate>
+      | dsl::else_ >> dsl::p<user_definition>;
   static constexpr auto value = lexy::construct<ast::command>;
 };
 
@@ -1099,4 +1752,40 @@ std::optional<std::string_view> find_binary_builtin(std::string_view name)
   return r::find_binary_builtin(
       name, std::make_index_sequence<std::tuple_size_v<decltype(r::binary_builtins)>>{});
 }
+
+std::optional<unary_function> find_unary_function(std::string_view name)
+{
+  return r::find_unary_function_(
+      name, std::make_index_sequence<std::tuple_size_v<decltype(r::unary_builtins)>>{});
+}
+
+std::optional<binary_function> find_binary_function(std::string_view name)
+{
+  return r::find_binary_function_(
+      name, std::make_index_sequence<std::tuple_size_v<decltype(r::binary_builtins)>>{});
+}
+
+std::optional<unary_function_fp64> find_unary_function_fp64(std::string_view name)
+{
+  return r::find_unary_function_fp64_(
+      name, std::make_index_sequence<std::tuple_size_v<decltype(r::unary_builtins)>>{});
+}
+
+std::optional<binary_function_fp64> find_binary_function_fp64(std::string_view name)
+{
+  return r::find_binary_function_fp64_(
+      name, std::make_index_sequence<std::tuple_size_v<decltype(r::binary_builtins)>>{});
+}
+
+std::optional<unary_kernel> find_unary_kernel(std::string_view name)
+{
+  return r::find_unary_kernel_(
+      name, std::make_index_sequence<std::tuple_size_v<decltype(r::unary_builtins)>>{});
+}
+
+std::optional<binary_kernel> find_binary_kernel(std::string_view name)
+{
+  return r::find_binary_kernel_(
+      name, std::make_index_sequence<std::tuple_size_v<decltype(r::binary_builtins)>>{});
+}
 } // namespace explot
@@ -2,6 +2,7 @@
 
 #include <variant>
 #include <vector>
+#include "batch_math.hpp"
 #include "box.hpp"
 #include "range_setting.hpp"
 #include "commands.hpp"
@@ -12,7 +13,7 @@ namespace ast
 {
 struct literal_expr final
 {
-  float value;
+  double value;
 };
 
 struct data_ref
@@ -22,14 +23,16 @@ struct data_ref
 
 struct unary_op;
 struct binary_op;
+struct ternary_op;
 struct var_or_call;
 using expr = std::variant<ast::literal_expr, box<ast::unary_op>, box<ast::binary_op>,
-                          box<ast::var_or_call>, ast::data_ref>;
+                          box<ast::ternary_op>, box<ast::var_or_call>, ast::data_ref>;
 
 enum class unary_operator
 {
   minus,
-  plus
+  plus,
+  logical_not
 };
 
 struct unary_op final
@@ -44,7 +47,15 @@ enum class binary_operator
   minus,
   mult,
   div,
-  power
+  power,
+  less,
+  less_equal,
+  greater,
+  greater_equal,
+  equal,
+  not_equal,
+  logical_and,
+  logical_or
 };
 
 struct binary_op final
@@ -54,6 +65,14 @@ struct binary_op final
   expr rhs;
 };
 
+// condition ? then : otherwise
+struct ternary_op final
+{
+  expr condition;
+  expr then;
+  expr otherwise;
+};
+
 struct var_or_call final
 {
   std::string name;
@@ -69,11 +88,34 @@ struct line_type_spec
 
 using line_type_desc = std::variant<line_type_spec, uint32_t>;
 
+struct live_options final
+{
+  // keep only the last window points
+  std::optional<uint32_t> window;
+};
+
 struct csv_data final
 {
   std::string path;
   std::vector<expr> expressions;
   bool matrix;
+  std::optional<live_options> live;
+  // set if the path is the variable of a for iteration
+  std::optional<std::string> path_var;
+};
+
+struct iteration_range final
+{
+  int first;
+  int last;
+  int step;
+};
+
+// for [variable in "a b c"] or for [variable=first:last:step] in front of a graph
+struct iteration final
+{
+  std::string variable;
+  std::variant<std::vector<std::string>, iteration_range> values;
 };
 
 enum struct mark_type_2d
@@ -133,9 +175,16 @@ struct plot_command_3d final
   range_setting u_range;
   range_setting v_range;
 };
+struct bind_command
+{
+  std::string name;
+  range_setting range;
+};
+
 using command =
     std::variant<plot_command_2d, plot_command_3d, user_definition, set_command, quit_command,
-                 unset_command, show_command, cd_command, pwd_command, load_command>;
+                 unset_command, show_command, cd_command, pwd_command, load_command,
+                 ast::bind_command, animate_command>;
 
 } // namespace ast
 
@@ -144,4 +193,19 @@ std::optional<ast::command> parse_command_ast(std::string_view line);
 std::optional<std::string_view> find_unary_builtin(std::string_view name);
 std::optional<std::string_view> find_binary_builtin(std::string_view name);
 std::optional<float> find_constant_builtin(std::string_view name);
+
+using unary_function = float (*)(float);
+using binary_function = float (*)(float, float);
+// the implementations of the builtins for evaluation on the CPU
+std::optional<unary_function> find_unary_function(std::string_view name);
+std::optional<binary_function> find_binary_function(std::string_view name);
+
+using unary_function_fp64 = double (*)(double);
+using binary_function_fp64 = double (*)(double, double);
+std::optional<unary_function_fp64> find_unary_function_fp64(std::string_view name);
+std::optional<binary_function_fp64> find_binary_function_fp64(std::string_view name);
+
+// the same functions for arrays, see batch_math.hpp
+std::optional<unary_kernel> find_unary_kernel(std::string_view name);
+std::optional<binary_kernel> find_binary_kernel(std::string_view name);
 } // namespace explot
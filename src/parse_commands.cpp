@@ -1,4 +1,5 @@
 #include "parse_commands.hpp"
+#include <array>
 #include <expected>
 #include <cassert>
 #include <fmt/format.h>
@@ -7,6 +8,7 @@
 #include <algorithm>
 #include <ranges>
 #include <tuple>
+#include <string_view>
 #include "commands.hpp"
 #include "parse_ast.hpp"
 #include "overload.hpp"
@@ -43,17 +45,8 @@ auto moving_range(auto &c)
                                std::make_move_iterator(c.end()));
 }
 
-unary_operator transform_unary_op(ast::unary_operator op)
-{
-  switch (op)
-  {
-  case ast::unary_operator::minus:
-    return unary_operator::minus;
-  case ast::unary_operator::plus:
-    return unary_operator::plus;
-  }
-}
-
+// Validates e and converts it to the flat expr in one pass over the tree, without building a second
+// one.
 std::expected<expr, std::string>
 validate_expression(ast::expr &&e, std::span<const std::string> vars, bool dataref_allowed)
 {
@@ -61,48 +54,84 @@ validate_expression(ast::expr &&e, std::span<const std::string> vars, bool datar
   {
     std::span<const std::string> vars;
     bool dataref_allowed;
+    // the nodes are added after their arguments, so the root of e is added last
+    expr &result;
 
-    std::expected<expr, std::string> operator()(ast::literal_expr &&l) const
+    std::expected<uint32_t, std::string> operator()(ast::literal_expr &&l) const
     {
-      return literal_expr{l.value};
+      return result.add_literal(l.value);
     }
-    std::expected<expr, std::string> operator()(box<ast::unary_op> &&o) const
+    std::expected<uint32_t, std::string> operator()(box<ast::unary_op> &&o) const
     {
       return std::visit(*this, std::move(o->operand))
-          .transform([&](expr &&operand)
-                     { return box{unary_op{transform_unary_op(o->op), std::move(operand)}}; });
+          .transform(
+              [&](uint32_t operand)
+              {
+                switch (o->op)
+                {
+                case ast::unary_operator::minus:
+                  return result.add(expr_op::neg, std::array{operand});
+                case ast::unary_operator::plus:
+                  return operand;
+                case ast::unary_operator::logical_not:
+                  return result.add(expr_op::logical_not, std::array{operand});
+                }
+              });
     }
-    std::expected<expr, std::string> operator()(box<ast::binary_op> &&o) const
+    std::expected<uint32_t, std::string> operator()(box<ast::binary_op> &&o) const
     {
       return std::visit(*this, std::move(o->lhs))
           .and_then(
-              [&](expr &&lhs)
+              [&](uint32_t lhs)
               {
                 return std::visit(*this, std::move(o->rhs))
                     .transform(
-                        [&](expr &&rhs) -> expr
+                        [&](uint32_t rhs)
                         {
+                          const auto args = std::array{lhs, rhs};
                           switch (o->op)
                           {
                           case ast::binary_operator::div:
-                            return box(
-                                binary_op{std::move(lhs), binary_operator::div, std::move(rhs)});
+                            return result.add(expr_op::div, args);
                           case ast::binary_operator::mult:
-                            return box(
-                                binary_op{std::move(lhs), binary_operator::mult, std::move(rhs)});
+                            return result.add(expr_op::mul, args);
                           case ast::binary_operator::minus:
-                            return box(
-                                binary_op{std::move(lhs), binary_operator::minus, std::move(rhs)});
+                            return result.add(expr_op::sub, args);
                           case ast::binary_operator::plus:
-                            return box(
-                                binary_op{std::move(lhs), binary_operator::plus, std::move(rhs)});
+                            return result.add(expr_op::add, args);
                           case ast::binary_operator::power:
-                            return box(binary_builtin_call{"pow", std::move(lhs), std::move(rhs)});
+                            return result.add(expr_op::binary_call, args, result.add_name("pow"));
+                          case ast::binary_operator::less:
+                            return result.add(expr_op::less, args);
+                          case ast::binary_operator::less_equal:
+                            return result.add(expr_op::less_equal, args);
+                          case ast::binary_operator::greater:
+                            return result.add(expr_op::greater, args);
+                          case ast::binary_operator::greater_equal:
+                            return result.add(expr_op::greater_equal, args);
+                          case ast::binary_operator::equal:
+                            return result.add(expr_op::equal, args);
+                          case ast::binary_operator::not_equal:
+                            return result.add(expr_op::not_equal, args);
+                          case ast::binary_operator::logical_and:
+                            return result.add(expr_op::logical_and, args);
+                          case ast::binary_operator::logical_or:
+                            return result.add(expr_op::logical_or, args);
                           }
                         });
               });
     }
-    std::expected<expr, std::string> operator()(box<ast::var_or_call> &&v) const
+    std::expected<uint32_t, std::string> operator()(box<ast::ternary_op> &&o) const
+    {
+      auto operands = std::array{std::move(o->condition), std::move(o->then),
+                                 std::move(o->otherwise)};
+      return validate_all(moving_range(operands)
+                          | std::views::transform([&](ast::expr &&e)
+                                                  { return std::visit(*this, std::move(e)); }))
+          .transform([&](std::vector<uint32_t> &&args)
+                     { return result.add(expr_op::select, args); });
+    }
+    std::expected<uint32_t, std::string> operator()(box<ast::var_or_call> &&v) const
     {
       if (v->params)
       {
@@ -117,9 +146,10 @@ validate_expression(ast::expr &&e, std::span<const std::string> vars, bool datar
           {
             return std::visit(*this, std::move(v->params->at(0)))
                 .transform(
-                    [&](expr &&arg)
+                    [&](uint32_t arg)
                     {
-                      return box{unary_builtin_call{std::string(uname.value()), std::move(arg)}};
+                      return result.add(expr_op::unary_call, std::array{arg},
+                                        result.add_name(*uname));
                     });
           }
         }
@@ -134,21 +164,21 @@ validate_expression(ast::expr &&e, std::span<const std::string> vars, bool datar
           {
             return std::visit(*this, std::move(v->params->at(0)))
                 .and_then(
-                    [&](expr &&arg1)
+                    [&](uint32_t arg1)
                     {
                       return std::visit(*this, std::move(v->params->at(1)))
                           .transform(
-                              [&](expr &&arg2)
+                              [&](uint32_t arg2)
                               {
-                                return box(binary_builtin_call{std::string(bname.value()),
-                                                               std::move(arg1), std::move(arg2)});
+                                return result.add(expr_op::binary_call, std::array{arg1, arg2},
+                                                  result.add_name(*bname));
                               });
                     });
           }
         }
         else if (auto idx = find_user_function(v->name); idx)
         {
-          auto &def = get_definition(*idx);
+          const auto def = get_definition(*idx);
           if (def.params->size() != v->params->size())
           {
             return std::unexpected(fmt::format("function {} takes {} arguments but got {}.",
@@ -156,13 +186,12 @@ validate_expression(ast::expr &&e, std::span<const std::string> vars, bool datar
           }
           else
           {
-            return validate_all(
-                       moving_range(*v->params)
-                       | std::views::transform(
-                           [&](ast::expr &&arg)
-                           { return validate_expression(std::move(arg), vars, dataref_allowed); }))
-                .transform([&](std::vector<expr> &&args)
-                           { return box{user_function_call{*idx, std::move(args)}}; });
+            auto args = moving_range(*v->params)
+                        | std::views::transform([&](ast::expr &&arg)
+                                                { return std::visit(*this, std::move(arg)); });
+            return validate_all(args).transform(
+                [&](std::vector<uint32_t> &&nodes)
+                { return result.add(expr_op::user_call, nodes, *idx); });
           }
         }
         else
@@ -174,15 +203,15 @@ validate_expression(ast::expr &&e, std::span<const std::string> vars, bool datar
       {
         if (auto value = find_constant_builtin(v->name); value)
         {
-          return literal_expr{*value};
+          return result.add_literal(*value);
         }
         else if (std::ranges::find(vars, v->name) != vars.end())
         {
-          return var{std::move(v->name)};
+          return result.add(expr_op::variable, {}, result.add_name(v->name));
         }
         else if (auto idx = find_user_variable(v->name); idx)
         {
-          return user_var_ref{*idx};
+          return result.add(expr_op::user_variable, {}, *idx);
         }
         else
         {
@@ -190,11 +219,11 @@ validate_expression(ast::expr &&e, std::span<const std::string> vars, bool datar
         }
       }
     }
-    std::expected<expr, std::string> operator()(ast::data_ref &&d) const
+    std::expected<uint32_t, std::string> operator()(ast::data_ref &&d) const
     {
       if (dataref_allowed)
       {
-        return data_ref{d.idx};
+        return result.add(expr_op::column, {}, static_cast<uint32_t>(d.idx));
       }
       else
       {
@@ -202,11 +231,18 @@ validate_expression(ast::expr &&e, std::span<const std::string> vars, bool datar
       }
     };
   };
-  return std::visit(validator{vars, dataref_allowed}, std::move(e));
+  auto result = expr();
+  return std::visit(validator{vars, dataref_allowed, result}, std::move(e))
+      .transform([&](uint32_t) { return std::move(result); });
 }
 
 std::expected<csv_data, std::string> validate(mark_type_3d mark, ast::csv_data &&data)
 {
+  if (data.path_var)
+  {
+    // only variables of a for iteration can be used as path
+    return std::unexpected(fmt::format("unknown variable '{}'", *data.path_var));
+  }
   return validate_all(std::move(data.expressions)
                       | std::views::transform(
                           [](ast::expr &e) { return validate_expression(std::move(e), {}, true); }))
@@ -259,6 +295,11 @@ std::expected<csv_data, std::string> validate(mark_type_3d mark, ast::csv_data &
 
 std::expected<csv_data, std::string> validate(mark_type_2d mark, ast::csv_data &&data)
 {
+  if (data.path_var)
+  {
+    // only variables of a for iteration can be used as path
+    return std::unexpected(fmt::format("unknown variable '{}'", *data.path_var));
+  }
   return [&] -> std::expected<std::vector<expr>, std::string>
   {
     if (mark == mark_type_2d::impulses)
@@ -445,7 +486,34 @@ std::expected<data_source_2d, std::string> validate(mark_type_2d mark, ast::data
             }
           },
           [&](ast::csv_data &&csv) -> std::expected<data_source_2d, std::string>
-          { return validate(mark, std::move(csv)); }),
+          {
+            if (!csv.live)
+            {
+              return validate(mark, std::move(csv));
+            }
+            static constexpr auto prefix = std::string_view("unix:");
+            if (!csv.path.starts_with(prefix))
+            {
+              return std::unexpected("live data needs a socket path starting with \"unix:\"");
+            }
+            if (csv.matrix)
+            {
+              return std::unexpected("live data cannot be a matrix");
+            }
+            const auto window = csv.live->window;
+            if (window && *window < 2)
+            {
+              return std::unexpected("live window needs at least 2 points");
+            }
+            return validate(mark, std::move(csv))
+                .transform(
+                    [&](csv_data &&d) -> data_source_2d
+                    {
+                      return live_data{.socket = d.path.substr(prefix.size()),
+                                       .expressions = std::move(d.expressions),
+                                       .window = window};
+                    });
+          }),
       std::move(d));
 }
 
@@ -465,7 +533,13 @@ std::expected<data_source_3d, std::string> validate(mark_type_3d mark, ast::data
             }
           },
           [&](ast::csv_data &&csv) -> std::expected<data_source_3d, std::string>
-          { return validate(mark, std::move(csv)); }),
+          {
+            if (csv.live)
+            {
+              return std::unexpected("live data is only supported for plot");
+            }
+            return validate(mark, std::move(csv));
+          }),
       std::move(d));
 }
 
@@ -590,7 +664,12 @@ std::expected<plot_command_2d, std::string> validate(ast::plot_command_2d &&plot
                                    .timefmt = settings::timefmt(),
                                    .samples = settings::samples(),
                                    .isosamples = settings::isosamples(),
-                                   .separator = settings::datafile::separator()};
+                                   .separator = settings::datafile::separator(),
+                                   .engine = settings::datafile::engine(),
+                                   .datafile_cache = settings::datafile::cache(),
+                                   .evaluation = settings::evaluation(),
+                                   .sampling = settings::sampling(),
+                                   .precision = settings::precision()};
           });
 }
 
@@ -610,10 +689,45 @@ std::expected<plot_command_3d, std::string> validate(ast::plot_command_3d &&plot
                                    .v_range = plot.v_range,
                                    .samples = settings::samples(),
                                    .isosamples = settings::isosamples(),
-                                   .separator = settings::datafile::separator()};
+                                   .separator = settings::datafile::separator(),
+                                   .engine = settings::datafile::engine(),
+                                   .datafile_cache = settings::datafile::cache(),
+                                   .evaluation = settings::evaluation()};
           });
 }
 
+// only constant variables can be changed without evaluating the expressions, which use them
+std::expected<void, std::string> validate_parameter(std::string_view name)
+{
+  if (auto idx = find_user_variable(name); idx && !constant_value(*idx))
+  {
+    return std::unexpected(fmt::format("{} is not a constant", name));
+  }
+  return {};
+}
+
+std::expected<bind_command, std::string> validate(ast::bind_command &&cmd)
+{
+  auto bound = [](range_value &v) { return v ? std::get_if<float>(&*v) : nullptr; };
+  const auto *lower = bound(cmd.range.lower_bound);
+  const auto *upper = bound(cmd.range.upper_bound);
+  if (lower == nullptr || upper == nullptr || *lower >= *upper)
+  {
+    return std::unexpected("range of a slider needs a lower and a greater upper bound");
+  }
+  return validate_parameter(cmd.name).transform(
+      [&]() { return bind_command{std::move(cmd.name), *lower, *upper}; });
+}
+
+std::expected<animate_command, std::string> validate(animate_command &&cmd)
+{
+  if (cmd.fps <= 0.0f)
+  {
+    return std::unexpected("fps must be positive");
+  }
+  return validate_parameter(cmd.name).transform([&]() { return std::move(cmd); });
+}
+
 std::expected<set_command, std::string> validate(set_command &&cmd)
 {
   return std::visit(
@@ -627,6 +741,36 @@ std::expected<set_command, std::string> validate(set_command &&cmd)
             return std::unexpected("rgbformulae must be in the range -36 .. 36");
           }
         }
+        if constexpr (std::remove_cvref_t<decltype(v)>::id == settings_id::evaluation)
+        {
+          // every implementation supports at least 1024 invocations per workgroup
+          if (v.value.workgroup_size == 0 || v.value.workgroup_size > 1024)
+          {
+            return std::unexpected("workgroup size must be in the range 1 .. 1024");
+          }
+        }
+        if constexpr (std::remove_cvref_t<decltype(v)>::id == settings_id::evaluation_budget)
+        {
+          if (v.value == 0 || v.value > (1u << 20))
+          {
+            return std::unexpected("evaluation budget must be in the range 1 .. 1048576 MB");
+          }
+        }
+        if constexpr (std::remove_cvref_t<decltype(v)>::id == settings_id::datafile_cache)
+        {
+          if (v.value > (1u << 20))
+          {
+            return std::unexpected("datafile cache must be in the range 0 .. 1048576 MB");
+          }
+        }
+        if constexpr (std::remove_cvref_t<decltype(v)>::id == settings_id::sampling)
+        {
+          // points are counted with prefix_sum, which counts exactly up to 2^24
+          if (v.value.max_points < 2 || v.value.max_points > (1u << 24))
+          {
+            return std::unexpected("maximum number of points must be in the range 2 .. 16777216");
+          }
+        }
         return std::move(cmd);
       },
       cmd.value);
@@ -658,6 +802,10 @@ std::expected<command, std::string> parse_command(std::string_view line)
             [](pwd_command &&cmd) -> std::expected<command, std::string> { return std::move(cmd); },
             [](load_command &&cmd) -> std::expected<command, std::string>
             { return std::move(cmd); },
+            [](ast::bind_command &&cmd) -> std::expected<command, std::string>
+            { return validate(std::move(cmd)); },
+            [](animate_command &&cmd) -> std::expected<command, std::string>
+            { return validate(std::move(cmd)); },
             [](ast::user_definition &&cmd) -> std::expected<command, std::string>
             {
               const auto params =
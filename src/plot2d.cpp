@@ -5,6 +5,9 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <cassert>
 #include "minmax.hpp"
+#include "overload.hpp"
+#include "user_definitions.hpp"
+#include <algorithm>
 
 namespace
 {
@@ -12,6 +15,7 @@ using namespace explot;
 
 constexpr auto lower_margin = glm::vec3(100.0f, 50.0f, 0.0f);
 constexpr auto upper_margin = glm::vec3(50.0f, 20.0f, 0.0f);
+constexpr auto max_cached_views = 8uz;
 
 void set_viewport(const rect &r)
 {
@@ -20,14 +24,186 @@ void set_viewport(const rect &r)
              static_cast<GLsizei>(r.upper_bounds.y - r.lower_bounds.y));
 }
 
+glm::vec2 x_range(const range_setting &r)
+{
+  auto bound = [](const range_value &v, float fallback)
+  {
+    return std::visit(overload([](float f) { return f; }, [=](auto_scale) { return fallback; }),
+                      v.value_or(fallback));
+  };
+  return glm::vec2(bound(r.lower_bound, -10.0f), bound(r.upper_bound, 10.0f));
+}
+
+// The view is moved by the origin of the graph before the transform is computed. Both are floats
+// close to each other, so the difference is exact.
+transforms_2d graph_transforms(const plot2d &plot, const graph2d &g)
+{
+  auto view = plot.view;
+  const auto origin = glm::vec3(g.origin, 0.0f);
+  view.lower_bounds -= origin;
+  view.upper_bounds -= origin;
+  return transforms_2d{.phase_to_screen = transform(view, plot.screen),
+                       .screen_to_clip = transform(plot.screen, clip_rect)};
+}
+
+std::vector<std::pair<uint32_t, float>> variable_values(const expr &e)
+{
+  auto variables = std::vector<uint32_t>();
+  used_variables(e, variables);
+  auto result = std::vector<std::pair<uint32_t, float>>();
+  for (auto idx : variables)
+  {
+    if (auto value = constant_value(idx))
+    {
+      result.emplace_back(idx, *value);
+    }
+  }
+  return result;
+}
+
+// The programs of function graphs are cached and only their uniforms change, so the points are
+// evaluated again in place. Cached views have the old values and are dropped.
+void update_variables(plot2d &plot)
+{
+  for (auto &f : plot.functions)
+  {
+    auto values = variable_values(f.function);
+    if (values == f.variables)
+    {
+      continue;
+    }
+    f.variables = std::move(values);
+    f.views.clear();
+    const auto xrange = range_setting{.lower_bound = f.x.x, .upper_bound = f.x.y};
+    auto &g = plot.graphs[f.graph];
+    if (update_function_2d(g.vbo, plot.command, f.mark, f.function, f.num_points, xrange))
+    {
+      continue;
+    }
+    auto [vbo, desc] = data_for_function_2d(plot.command, f.mark, f.function, f.num_points, xrange);
+    g = graph2d(std::move(vbo), desc, f.mark, g.lt);
+    f.desc = std::move(desc);
+    update(g, graph_transforms(plot, g));
+  }
+}
+
+// Creates sliders, if variables used by function graphs were bound or unbound.
+void update_bindings(plot2d &plot)
+{
+  auto bindings = variable_bindings();
+  std::erase_if(bindings,
+                [&](const variable_binding &b)
+                {
+                  return std::ranges::none_of(
+                      plot.functions, [&](const function_graph &f)
+                      { return std::ranges::any_of(f.variables, [&](const auto &v)
+                                                   { return v.first == b.variable; }); });
+                });
+  if (bindings == plot.bindings)
+  {
+    return;
+  }
+  plot.bindings = std::move(bindings);
+  plot.controls.reset();
+  if (!plot.bindings.empty())
+  {
+    plot.controls.emplace(plot.bindings);
+    update(*plot.controls, plot.plot_screen, transform(plot.screen, clip_rect));
+  }
+}
+
+// The x range of the view, in which function graphs are sampled, limited by the explicit bounds of
+// the x range of the plot.
+glm::vec2 sampled_x(const range_setting &r, const rect &view)
+{
+  auto x = glm::vec2(view.lower_bounds.x, view.upper_bounds.x);
+  if (const auto *lower = r.lower_bound ? std::get_if<float>(&*r.lower_bound) : nullptr)
+  {
+    x.x = std::max(x.x, *lower);
+  }
+  if (const auto *upper = r.upper_bound ? std::get_if<float>(&*r.upper_bound) : nullptr)
+  {
+    x.y = std::min(x.y, *upper);
+  }
+  return x;
+}
+
+// Replaces the points of function graphs, whose x range differs from the view. The replaced points
+// are kept as views. Graphs without a cached view are evaluated together like in data_for_plot.
+void update_functions(plot2d &plot)
+{
+  const auto num_points = plot.command.samples.x;
+  const auto x = sampled_x(plot.command.x_range, plot.view);
+  if (!(x.x < x.y))
+  {
+    return;
+  }
+  auto missing = std::vector<function_graph *>();
+  for (auto &f : plot.functions)
+  {
+    if (f.x == x && f.num_points == num_points)
+    {
+      continue;
+    }
+    auto &g = plot.graphs[f.graph];
+    auto current = function_view{f.x, f.num_points, std::move(g.vbo), std::move(f.desc)};
+    auto cached = std::ranges::find_if(f.views, [&](const function_view &v)
+                                       { return v.x == x && v.num_points == num_points; });
+    auto next = std::optional<function_view>();
+    if (cached != f.views.end())
+    {
+      next = std::move(*cached);
+      f.views.erase(cached);
+    }
+    f.views.insert(f.views.begin(), std::move(current));
+    if (f.views.size() > max_cached_views)
+    {
+      f.views.pop_back();
+    }
+    if (!next)
+    {
+      missing.push_back(&f);
+      continue;
+    }
+    g = graph2d(std::move(next->vbo), next->desc, f.mark, g.lt);
+    f.x = next->x;
+    f.num_points = next->num_points;
+    f.desc = std::move(next->desc);
+  }
+  if (missing.empty())
+  {
+    return;
+  }
+
+  auto functions = std::vector<std::pair<mark_type_2d, const expr *>>();
+  for (const auto *f : missing)
+  {
+    functions.emplace_back(f->mark, &f->function);
+  }
+  auto data = data_for_functions_2d(plot.command, functions, num_points,
+                                    range_setting{.lower_bound = x.x, .upper_bound = x.y});
+  for (auto i = 0uz; i < missing.size(); ++i)
+  {
+    auto &f = *missing[i];
+    auto &[vbo, desc] = data[i];
+    auto &g = plot.graphs[f.graph];
+    g = graph2d(std::move(vbo), desc, f.mark, g.lt);
+    f.x = x;
+    f.num_points = num_points;
+    f.desc = std::move(desc);
+  }
+}
+
 } // namespace
 
 namespace explot
 {
 
 plot2d::plot2d(const plot_command_2d &cmd)
-    : legend(cmd.graphs), cs(5, 9, 2, time_point(), cmd.xdata, cmd.timefmt)
+    : command(cmd), legend(cmd.graphs), cs(5, 9, 2, time_point(), cmd.xdata, cmd.timefmt),
+      definitions_version(explot::definitions_version())
 {
+  command.graphs.clear();
   graphs.reserve(cmd.graphs.size());
   auto [data, tb] = data_for_plot(cmd);
   auto bounding = std::optional<rect>();
@@ -35,7 +211,20 @@ plot2d::plot2d(const plot_command_2d &cmd)
   {
     const auto &g = cmd.graphs[i];
     auto &[vbo, desc] = data[i];
-    auto br = bounding_rect_2d(vbo, desc.num_points);
+    if (const auto *d = std::get_if<live_data>(&g.data))
+    {
+      auto buffer = make_live_buffer(d->expressions, d->window);
+      auto source = open_live_source(d->socket, cmd.separator, buffer.indices);
+      live.emplace_back(i, g.mark, std::move(source), std::move(buffer));
+      graphs.emplace_back(std::move(vbo), desc, g.mark, g.line_type);
+      continue;
+    }
+    auto br = desc.bounds ? *desc.bounds : bounding_rect_2d(vbo, desc.num_points);
+    if (const auto *e = std::get_if<expr>(&g.data))
+    {
+      functions.push_back(function_graph{i, g.mark, *e, x_range(cmd.x_range), cmd.samples.x, desc,
+                                         variable_values(*e), {}});
+    }
     graphs.emplace_back(std::move(vbo), desc, g.mark, g.line_type);
     bounding = union_rect(bounding.value_or(br), br);
   }
@@ -53,6 +242,10 @@ void draw(const plot2d &plot)
   draw(plot.legend);
   set_viewport(plot.screen);
   draw(plot.cs);
+  if (plot.controls)
+  {
+    draw(*plot.controls);
+  }
 }
 
 void update_screen(plot2d &plot, const rect &screen)
@@ -64,23 +257,108 @@ void update_screen(plot2d &plot, const rect &screen)
 
   update(plot.legend, screen, transforms.screen_to_clip);
   update_screen(plot.cs, plot.plot_screen, transforms);
+  if (plot.controls)
+  {
+    update(*plot.controls, plot.plot_screen, transforms.screen_to_clip);
+  }
+  update_functions(plot);
   for (const auto &g : plot.graphs)
   {
-    update(g, transforms);
+    update(g, graph_transforms(plot, g));
   }
 }
 
 void update_view(plot2d &plot, const rect &view)
 {
-  auto rounded_view = round_for_ticks_2d(view, 5, 2);
+  plot.requested_view = view;
+  auto scrolled = view;
+  if (plot.scroll_x)
+  {
+    scrolled.lower_bounds.x = plot.scroll_x->x;
+    scrolled.upper_bounds.x = plot.scroll_x->y;
+  }
+  auto rounded_view = round_for_ticks_2d(scrolled, 5, 2);
   plot.view = rounded_view.bounding_rect;
   transforms_2d transforms = {.phase_to_screen = transform(plot.view, plot.screen),
                               .screen_to_clip = transform(plot.screen, clip_rect)};
 
   update_view(plot.cs, rounded_view, transforms);
+  update_functions(plot);
   for (const auto &g : plot.graphs)
   {
-    update(g, transforms);
+    update(g, graph_transforms(plot, g));
+  }
+}
+
+void poll(plot2d &plot)
+{
+  if (plot.definitions_version != explot::definitions_version())
+  {
+    plot.definitions_version = explot::definitions_version();
+    update_variables(plot);
+    if (plot.controls)
+    {
+      update_values(*plot.controls);
+    }
+  }
+  update_bindings(plot);
+
+  auto scroll = false;
+  for (auto &l : plot.live)
+  {
+    auto rows = take_rows(*l.source);
+    if (rows.empty())
+    {
+      continue;
+    }
+    auto &g = plot.graphs[l.graph];
+    auto &b = l.buffer;
+    if (auto vbo = append(b, g.vbo, rows))
+    {
+      g = graph2d(std::move(*vbo), seq_data_desc(b.point_size, b.capacity + 1), l.mark, g.lt);
+      update(g, graph_transforms(plot, g));
+    }
+    resize(g, first_point(b), size(b), b.capacity);
+    scroll = scroll || b.window.has_value();
+  }
+
+  if (scroll)
+  {
+    auto x = std::optional<glm::vec2>();
+    for (const auto &l : plot.live)
+    {
+      // a range without points has min > max
+      if (auto bx = window_x_range(l.buffer); l.buffer.window && bx.x <= bx.y)
+      {
+        x = x ? glm::vec2(std::min(x->x, bx.x), std::max(x->y, bx.y)) : bx;
+      }
+    }
+    if (!x)
+    {
+      return;
+    }
+    if (x->y - x->x < 1e-8)
+    {
+      x->x -= 1.0f;
+      x->y += 1.0f;
+    }
+    plot.scroll_x = x;
+    update_view(plot, plot.requested_view);
+  }
+}
+
+std::optional<std::size_t> slider_at(const plot2d &plot, glm::vec2 position)
+{
+  return plot.controls ? slider_at(*plot.controls, position) : std::nullopt;
+}
+
+void move_slider(plot2d &plot, std::size_t slider, glm::vec2 position)
+{
+  const auto &s = plot.controls->items[slider];
+  // the variable could have been redefined since it was bound
+  if (constant_value(s.binding.variable))
+  {
+    set_variable(s.binding.variable, value_at(s, position));
   }
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include "rect.hpp"
 #include "graph2d.hpp"
@@ -7,23 +8,79 @@
 #include "legend.hpp"
 #include "csv.hpp"
 #include "coordinate_system_2d.hpp"
+#include "live_source.hpp"
+#include "sliders.hpp"
 
 namespace explot
 {
+struct live_graph
+{
+  std::size_t graph;
+  mark_type_2d mark;
+  std::unique_ptr<live_source> source;
+  live_buffer buffer;
+};
+
+// points of a function graph for an x range, evaluated with num_points samples
+struct function_view
+{
+  glm::vec2 x;
+  uint32_t num_points;
+  shared_vbo_handle vbo;
+  seq_data_desc desc;
+};
+
+// Function graphs are evaluated again for the x range of the view at the resolution of the screen.
+// The points of the last views are kept, so that zooming back out does not evaluate them again.
+struct function_graph
+{
+  std::size_t graph;
+  mark_type_2d mark;
+  expr function;
+  // x range and number of samples of the points in the graph
+  glm::vec2 x;
+  uint32_t num_points;
+  seq_data_desc desc;
+  // the constant user variables of the function with the values of the points
+  std::vector<std::pair<uint32_t, float>> variables;
+  // most recently used first
+  std::vector<function_view> views;
+};
+
 struct plot2d
 {
   plot2d(const plot_command_2d &cmd);
+  // the command without its graphs, to evaluate function graphs again
+  plot_command_2d command;
   rect phase_space;
   std::vector<graph2d> graphs;
+  std::vector<function_graph> functions;
+  std::vector<live_graph> live;
+  // x range of live graphs with a window, which overrides the x range of the view
+  std::optional<glm::vec2> scroll_x;
   legend legend;
+  // sliders for the bound variables of the function graphs
+  std::vector<variable_binding> bindings;
+  std::optional<sliders> controls;
   coordinate_system_2d cs;
   rect screen;
   rect plot_screen;
   rect view;
+  rect requested_view;
+  uint32_t definitions_version;
 };
 
 void update_screen(plot2d &plot, const rect &screen);
 void update_view(plot2d &plot, const rect &view);
+// Appends the rows that were received by live graphs since the last call and scrolls the view to
+// the points of live graphs with a window. Function graphs are evaluated again, if user variables
+// they use were changed.
+void poll(plot2d &plot);
 
 void draw(const plot2d &plot);
+
+// the slider at position in screen coordinates
+std::optional<std::size_t> slider_at(const plot2d &plot, glm::vec2 position);
+// sets the variable of a slider to the value at position in screen coordinates
+void move_slider(plot2d &plot, std::size_t slider, glm::vec2 position);
 } // namespace explot
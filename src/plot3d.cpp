@@ -12,7 +12,7 @@ namespace
 {
 using namespace explot;
 auto graphs_for_descs(const plot_command_3d &plot,
-                      std::vector<std::tuple<vbo_handle, data_desc>> &&data)
+                      std::vector<std::tuple<shared_vbo_handle, data_desc>> &&data)
 {
   const auto &graphs = plot.graphs;
   auto result = std::vector<graph3d>();
@@ -27,7 +27,10 @@ auto graphs_for_descs(const plot_command_3d &plot,
   return result;
 }
 
-auto bounding_rect(const graph3d &g) { return bounding_rect_3d(g.vbo, g.num_points, g.point_size); }
+auto bounding_rect(const graph3d &g)
+{
+  return g.bounds ? *g.bounds : bounding_rect_3d(g.vbo, g.num_points, g.point_size);
+}
 
 auto bounding_rect_for_graphs(std::span<const graph3d> graphs)
 {
@@ -117,7 +117,7 @@ void main()
 
 program_handle make_points_program(const char *vertex_shader_src)
 {
-  return make_program(geometry_shader_src, vertex_shader_src, fragment_shader_src);
+  return clone_program(make_program(geometry_shader_src, vertex_shader_src, fragment_shader_src));
 }
 
 program_handle make_points_2d_program() { return make_points_program(vertex_2d_shader_src); }
@@ -0,0 +1,80 @@
+#include "points_cache.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+using namespace explot;
+
+struct cache_entry
+{
+  cached_points points;
+  std::size_t bytes;
+  // the value of uses when the points were used last
+  uint64_t last_use;
+};
+
+struct points_cache
+{
+  std::unordered_map<std::string, cache_entry> entries;
+  std::size_t bytes = 0uz;
+  uint64_t uses = 0;
+};
+
+points_cache &cache()
+{
+  static auto c = points_cache();
+  return c;
+}
+
+// the entries, which only the cache refers to, are removed, least recently used first
+void evict(points_cache &c, std::size_t budget)
+{
+  while (c.bytes > budget)
+  {
+    auto oldest = c.entries.end();
+    for (auto it = c.entries.begin(); it != c.entries.end(); ++it)
+    {
+      if (it->second.points.vbo.use_count() == 1
+          && (oldest == c.entries.end() || it->second.last_use < oldest->second.last_use))
+      {
+        oldest = it;
+      }
+    }
+    if (oldest == c.entries.end())
+    {
+      return;
+    }
+    c.bytes -= oldest->second.bytes;
+    c.entries.erase(oldest);
+  }
+}
+} // namespace
+
+namespace explot
+{
+std::optional<cached_points> find_cached_points(std::string_view key)
+{
+  auto &c = cache();
+  auto it = c.entries.find(std::string(key));
+  if (it == c.entries.end())
+  {
+    return std::nullopt;
+  }
+  it->second.last_use = ++c.uses;
+  return it->second.points;
+}
+
+void cache_points(std::string key, cached_points points, std::size_t bytes, std::size_t budget)
+{
+  auto &c = cache();
+  if (auto it = c.entries.find(key); it != c.entries.end())
+  {
+    c.bytes -= it->second.bytes;
+    c.entries.erase(it);
+  }
+  c.bytes += bytes;
+  c.entries.emplace(std::move(key), cache_entry{std::move(points), bytes, ++c.uses});
+  evict(c, budget);
+}
+} // namespace explot
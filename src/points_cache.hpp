@@ -0,0 +1,36 @@
+#pragma once
+
+#include "csv.hpp"
+#include "gl-handle.hpp"
+#include <glm/vec2.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace explot
+{
+// the points of the using expressions of a datafile
+struct cached_points
+{
+  shared_vbo_handle vbo;
+  uint32_t num_points;
+  std::optional<uint32_t> columns;
+  // (min, max) of every component of the points
+  std::vector<glm::vec2> bounds;
+  // the timebase of the dates in the points, if any were read
+  std::optional<time_point> timebase;
+};
+
+// Points of datafiles are kept after the graphs using them are gone, so that plotting the same
+// expressions of a file again, e.g. with another style or in another multiplot panel, does not
+// read and evaluate the file again. Keys identify the file with its modification time and size, the
+// expressions and the settings used while parsing it, so that points are read again when any of
+// them changes. Only used on the GL thread.
+std::optional<cached_points> find_cached_points(std::string_view key);
+
+// Adds points, which take bytes of memory. Then the least recently used points, which are not used
+// by a graph anymore, are removed until all points take at most budget bytes.
+void cache_points(std::string key, cached_points points, std::size_t bytes, std::size_t budget);
+} // namespace explot
@@ -3,23 +3,297 @@
 #include "overload.hpp"
 #include <glm/gtc/type_ptr.hpp>
 #include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <array>
+#include <cassert>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-namespace explot
+namespace
 {
-program_handle make_program_with_varying(const char *shader_src, const char *varying)
+using namespace explot;
+
+std::string cache_key(std::initializer_list<std::string_view> parts)
 {
-  auto shader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(shader, 1, &shader_src, nullptr);
-  glCompileShader(shader);
+  auto key = std::string();
+  for (auto part : parts)
+  {
+    key.append(part);
+    key.push_back('\0');
+  }
+  return key;
+}
+
+struct program_binary
+{
+  GLenum format;
+  std::vector<std::byte> data;
+};
+
+struct program_entry
+{
+  program_handle program;
+  // the value of uses when the program was used last
+  uint64_t last_use;
+};
+
+// Programs are generated from expressions, so a session can make any number of them. Beyond this,
+// the least recently used programs which no caller holds anymore are deleted.
+constexpr auto max_cached_programs = 256uz;
+
+// Programs by their sources. Sources of a vertex shader with transform feedback are prefixed with
+// the varyings, which are part of the program. compilers keeps the compile functions by program for
+// clone_program, if the driver has no binary formats. Only used on the GL thread.
+struct program_cache
+{
+  std::unordered_map<std::string, program_entry> programs;
+  std::unordered_map<gl_id, std::function<program_handle()>> compilers;
+  std::unordered_map<gl_id, program_binary> binaries;
+  program_cache_stats stats;
+  uint64_t uses = 0;
+  std::optional<std::filesystem::path> dir;
+  // vendor, renderer and version of the driver, which made the binaries in dir
+  std::optional<std::string> driver;
+};
+
+program_cache &cache()
+{
+  static auto c = program_cache();
+  return c;
+}
+
+program_binary binary_of(gl_id program)
+{
+  auto length = GLint(0);
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  auto binary = program_binary{0, std::vector<std::byte>(static_cast<std::size_t>(length))};
+  if (length > 0)
+  {
+    glGetProgramBinary(program, length, nullptr, &binary.format, binary.data.data());
+  }
+  return binary;
+}
+
+std::optional<program_handle> load_binary(const program_binary &binary)
+{
+  if (binary.data.empty())
+  {
+    return std::nullopt;
+  }
   auto program = make_program();
-  glAttachShader(program, shader);
-  glTransformFeedbackVaryings(program, 1, &varying, GL_INTERLEAVED_ATTRIBS);
-  glLinkProgram(program);
-  glDeleteShader(shader);
+  glProgramBinary(program, binary.format, binary.data.data(),
+                  static_cast<GLsizei>(binary.data.size()));
+  auto link_status = GLint(0);
+  glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+  if (link_status != GL_TRUE)
+  {
+    return std::nullopt;
+  }
   return program;
 }
 
-program_handle make_program_with_varying(const char *shader_src, std::span<const char *> varyings)
+const std::string &driver(program_cache &c)
+{
+  if (!c.driver)
+  {
+    auto str = [](GLenum name)
+    {
+      auto s = glGetString(name);
+      return s == nullptr ? std::string() : std::string(reinterpret_cast<const char *>(s));
+    };
+    auto num_formats = GLint(0);
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    if (num_formats == 0)
+    {
+      c.dir.reset();
+    }
+    c.driver = cache_key({str(GL_VENDOR), str(GL_RENDERER), str(GL_VERSION)});
+  }
+  return *c.driver;
+}
+
+// FNV-1a, which is stable across runs and standard libraries unlike std::hash
+uint64_t stable_hash(std::string_view s, uint64_t h = 0xcbf29ce484222325ull)
+{
+  for (auto c : s)
+  {
+    h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+  }
+  return h;
+}
+
+// A file of the disk cache holds the magic, the binary format, the size of the key, the key, which
+// is checked against hash collisions, and the binary.
+constexpr auto magic = uint32_t(0x65787031);
+
+std::filesystem::path disk_path(const std::filesystem::path &dir, std::string_view key,
+                                std::string_view driver)
+{
+  return dir / fmt::format("{:016x}", stable_hash(key, stable_hash(driver)));
+}
+
+std::string disk_key(std::string_view key, std::string_view driver)
+{
+  return std::string(driver).append(key);
+}
+
+std::optional<program_binary> read_binary(const std::filesystem::path &path,
+                                          std::string_view key)
+{
+  auto f = std::ifstream(path, std::ios::binary);
+  if (!f.is_open())
+  {
+    return std::nullopt;
+  }
+  auto header = std::array<uint32_t, 2>();
+  auto key_size = uint64_t(0);
+  f.read(reinterpret_cast<char *>(header.data()), sizeof(header));
+  f.read(reinterpret_cast<char *>(&key_size), sizeof(key_size));
+  if (!f || header[0] != magic || key_size != key.size())
+  {
+    return std::nullopt;
+  }
+  auto stored_key = std::string(key_size, '\0');
+  f.read(stored_key.data(), static_cast<std::streamsize>(key_size));
+  if (!f || stored_key != key)
+  {
+    return std::nullopt;
+  }
+  const auto begin = f.tellg();
+  f.seekg(0, std::ios::end);
+  const auto size = static_cast<std::size_t>(f.tellg() - begin);
+  f.seekg(begin);
+  auto data = std::vector<std::byte>(size);
+  f.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(size));
+  if (!f)
+  {
+    return std::nullopt;
+  }
+  return program_binary{header[1], std::move(data)};
+}
+
+// Writes to a temporary file first, so that concurrent explot processes never read partial files.
+void write_binary(const std::filesystem::path &path, std::string_view key,
+                  const program_binary &binary)
+{
+  auto ec = std::error_code();
+  std::filesystem::create_directories(path.parent_path(), ec);
+  auto tmp = path;
+  tmp += fmt::format(".{:08x}", std::random_device()());
+  {
+    auto f = std::ofstream(tmp, std::ios::binary);
+    const auto header = std::array<uint32_t, 2>{magic, binary.format};
+    const auto key_size = uint64_t(key.size());
+    f.write(reinterpret_cast<const char *>(header.data()), sizeof(header));
+    f.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+    f.write(key.data(), static_cast<std::streamsize>(key.size()));
+    f.write(reinterpret_cast<const char *>(binary.data.data()),
+            static_cast<std::streamsize>(binary.data.size()));
+    if (!f)
+    {
+      std::filesystem::remove(tmp, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp, path, ec);
+  if (ec)
+  {
+    std::filesystem::remove(tmp, ec);
+  }
+}
+
+// Loads the program from the disk cache or compiles it and stores its binary there. Entries which
+// do not load anymore, e.g. after a driver update with the same version string, are removed.
+program_handle load_or_compile(program_cache &c, std::string_view key,
+                               const std::function<program_handle()> &compile)
+{
+  const auto &d = driver(c);
+  if (!c.dir)
+  {
+    return compile();
+  }
+  const auto path = disk_path(*c.dir, key, d);
+  const auto full_key = disk_key(key, d);
+  if (auto binary = read_binary(path, full_key))
+  {
+    if (auto program = load_binary(*binary))
+    {
+      ++c.stats.loaded;
+      c.binaries.emplace(*program, std::move(*binary));
+      return *program;
+    }
+    auto ec = std::error_code();
+    std::filesystem::remove(path, ec);
+  }
+  auto program = compile();
+  auto link_status = GLint(0);
+  glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+  if (link_status == GL_TRUE)
+  {
+    auto binary = binary_of(program);
+    if (!binary.data.empty())
+    {
+      write_binary(path, full_key, binary);
+      c.binaries.emplace(program, std::move(binary));
+    }
+  }
+  return program;
+}
+
+// the programs, which only the cache refers to, are deleted, least recently used first
+void evict(program_cache &c)
+{
+  while (c.programs.size() > max_cached_programs)
+  {
+    auto oldest = c.programs.end();
+    for (auto it = c.programs.begin(); it != c.programs.end(); ++it)
+    {
+      if (it->second.program.use_count() == 1
+          && (oldest == c.programs.end() || it->second.last_use < oldest->second.last_use))
+      {
+        oldest = it;
+      }
+    }
+    if (oldest == c.programs.end())
+    {
+      return;
+    }
+    const auto id = gl_id(oldest->second.program);
+    c.compilers.erase(id);
+    c.binaries.erase(id);
+    c.programs.erase(oldest);
+  }
+}
+
+program_handle cached(std::string key, std::function<program_handle()> compile)
+{
+  auto &c = cache();
+  if (auto it = c.programs.find(key); it != c.programs.end())
+  {
+    ++c.stats.hits;
+    it->second.last_use = ++c.uses;
+    return it->second.program;
+  }
+  ++c.stats.misses;
+  auto program = load_or_compile(c, key, compile);
+  c.compilers.emplace(program, std::move(compile));
+  c.programs.emplace(std::move(key), program_entry{program, ++c.uses});
+  evict(c);
+  return program;
+}
+
+void allow_binary_retrieval(gl_id program)
+{
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+program_handle compile_program_with_varying(const char *shader_src,
+                                            std::span<const char *const> varyings)
 {
   auto shader = glCreateShader(GL_VERTEX_SHADER);
   glShaderSource(shader, 1, &shader_src, nullptr);
@@ -27,13 +301,14 @@ program_handle make_program_with_varying(const char *shader_src, std::span<const
   auto program = make_program();
   glAttachShader(program, shader);
   glTransformFeedbackVaryings(program, varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+  allow_binary_retrieval(program);
   glLinkProgram(program);
   glDeleteShader(shader);
   return program;
 }
 
-program_handle make_program(const char *geometry_shader_src, const char *vertex_shader_src,
-                            const char *fragment_shader_src)
+program_handle compile_program(const char *geometry_shader_src, const char *vertex_shader_src,
+                               const char *fragment_shader_src)
 {
   auto program = make_program();
   auto vertex_shader = gl_id(0);
@@ -78,6 +353,7 @@ program_handle make_program(const char *geometry_shader_src, const char *vertex_
     }
     glAttachShader(program, fragment_shader);
   }
+  allow_binary_retrieval(program);
   glLinkProgram(program);
   glDeleteShader(vertex_shader);
   glDeleteShader(fragment_shader);
@@ -85,7 +361,7 @@ program_handle make_program(const char *geometry_shader_src, const char *vertex_
   return program;
 }
 
-program_handle make_compute_program(const char *compute_shader_src)
+program_handle compile_compute_program(const char *compute_shader_src)
 {
   auto program = make_program();
 
@@ -93,11 +369,88 @@ program_handle make_compute_program(const char *compute_shader_src)
   glShaderSource(compute_shader, 1, &compute_shader_src, nullptr);
   glCompileShader(compute_shader);
   glAttachShader(program, compute_shader);
+  allow_binary_retrieval(program);
   glLinkProgram(program);
   glDeleteShader(compute_shader);
 
   return program;
 }
+} // namespace
+
+namespace explot
+{
+program_handle make_program_with_varying(const char *shader_src, const char *varying)
+{
+  return make_program_with_varying(shader_src, std::span(&varying, 1));
+}
+
+program_handle make_program_with_varying(const char *shader_src, std::span<const char *> varyings)
+{
+  auto names = std::vector<std::string>(varyings.begin(), varyings.end());
+  auto key = fmt::format("varyings {}", fmt::join(names, " "));
+  return cached(cache_key({key, shader_src}),
+                [src = std::string(shader_src), names = std::move(names)]
+                {
+                  auto ptrs = std::vector<const char *>();
+                  for (const auto &name : names)
+                  {
+                    ptrs.push_back(name.c_str());
+                  }
+                  return compile_program_with_varying(src.c_str(), ptrs);
+                });
+}
+
+program_handle make_program(const char *geometry_shader_src, const char *vertex_shader_src,
+                            const char *fragment_shader_src)
+{
+  auto source = [](const char *src) { return src == nullptr ? std::string() : std::string(src); };
+  return cached(cache_key({"geometry", source(geometry_shader_src), "vertex",
+                           source(vertex_shader_src), "fragment", source(fragment_shader_src)}),
+                [geo = source(geometry_shader_src), vert = source(vertex_shader_src),
+                 frag = source(fragment_shader_src)]
+                {
+                  auto ptr = [](const std::string &s) { return s.empty() ? nullptr : s.c_str(); };
+                  return compile_program(ptr(geo), ptr(vert), ptr(frag));
+                });
+}
+
+program_handle make_compute_program(const char *compute_shader_src)
+{
+  return cached(cache_key({"compute", compute_shader_src}),
+                [src = std::string(compute_shader_src)]
+                { return compile_compute_program(src.c_str()); });
+}
+
+program_handle clone_program(gl_id program)
+{
+  auto &c = cache();
+  ++c.stats.clones;
+  auto binary = c.binaries.find(program);
+  if (binary == c.binaries.end())
+  {
+    binary = c.binaries.emplace(program, binary_of(program)).first;
+  }
+  if (auto clone = load_binary(binary->second))
+  {
+    return *clone;
+  }
+  // the driver has no binary formats or rejected the binary
+  auto compiler = c.compilers.find(program);
+  assert(compiler != c.compilers.end());
+  return compiler->second();
+}
+
+program_cache_stats program_cache_statistics() { return cache().stats; }
+
+void set_program_cache_dir(std::filesystem::path dir) { cache().dir = std::move(dir); }
+
+void clear_program_cache()
+{
+  auto &c = cache();
+  c.programs.clear();
+  c.compilers.clear();
+  c.binaries.clear();
+}
 
 void set_uniforms(gl_id program, std::span<const uniform> uniforms)
 {
@@ -2,12 +2,17 @@
 
 #include "gl-handle.hpp"
 #include <cstdint>
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <variant>
 #include <span>
 
 namespace explot
 {
+// Programs are compiled once per process and shared by all callers with the same sources, so
+// uniforms have to be set before every use. Programs which keep per-object state in uniforms are
+// made with clone_program. Beyond a fixed number of programs, the least recently used ones which no
+// caller holds anymore are deleted.
 program_handle make_program_with_varying(const char *shader_src, const char *varying);
 program_handle make_program_with_varying(const char *shader_src, std::span<const char *> varyings);
 program_handle make_program(const char *geometry_shader_src, const char *vertex_shader_src,
@@ -15,6 +20,29 @@ program_handle make_program(const char *geometry_shader_src, const char *vertex_
 
 program_handle make_compute_program(const char *compute_shader_src);
 
+// Returns a new program with the code of program and its own uniforms with default values. The
+// program is loaded from the binary of program, so no shader is compiled.
+program_handle clone_program(gl_id program);
+
+struct program_cache_stats
+{
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t clones = 0;
+  // misses which were loaded from the disk cache instead of compiled
+  uint64_t loaded = 0;
+};
+
+program_cache_stats program_cache_statistics();
+
+// Linked programs are also stored in dir with their binary and loaded from there by later
+// processes. Entries are keyed by the sources and the GL vendor, renderer and version. Has to be
+// called before the first program is made.
+void set_program_cache_dir(std::filesystem::path dir);
+
+// Deletes the cached programs. Has to be called before the GL context is destroyed.
+void clear_program_cache();
+
 using uniform_value = std::variant<float, glm::vec4, glm::vec3, glm::vec2, glm::mat4, uint32_t,
                                    std::span<const float>, std::span<const uint32_t>>;
 using uniform = std::pair<const char *, uniform_value>;
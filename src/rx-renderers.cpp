@@ -50,9 +50,13 @@ rx::observable<unit> plot_renderer(rx::observe_on_one_worker &on_run_loop,
              [=](rx::resource<plot_with_view_space> res)
              {
                auto ds = drags(screen_space, part).publish().ref_count();
+               // drags, which start on a slider, move its knob instead of zooming
+               auto on_slider = [res](const drag &d)
+               { return slider_at(const_get(res).plot, d.from).has_value(); };
                auto drops =
                    ds | rx::transform([](auto d) { return d.default_if_empty(drag{}).last(); })
-                   | rx::concat() | rx::filter([](const drag &d) { return d.from != d.to; });
+                   | rx::concat()
+                   | rx::filter([=](const drag &d) { return d.from != d.to && !on_slider(d); });
                auto local_screen = screen_space
                                    | rx::transform(
                                        [=](const rect &screen)
@@ -98,9 +102,13 @@ rx::observable<unit> plot_renderer(rx::observe_on_one_worker &on_run_loop,
                                       return frames | rx::observe_on(on_run_loop)
                                              | rx::take_until(closed(ds))
                                              | rx::with_latest_from(
-                                                 [res = std::move(res)](unit, const drag &d,
-                                                                        const rect &r)
+                                                 [=, res = std::move(res)](unit, const drag &d,
+                                                                           const rect &r)
                                                  {
+                                                   if (on_slider(d))
+                                                   {
+                                                     return unit{};
+                                                   }
                                                    set_viewport(r);
                                                    draw(const_get(res), drag_to_rect(d), r);
                                                    return unit{};
@@ -126,16 +134,29 @@ rx::observable<unit> plot_renderer(rx::observe_on_one_worker &on_run_loop,
                      return unit{};
                    });
 
+               auto slider_moves = ds | rx::switch_on_next() | rx::observe_on(on_run_loop)
+                                   | rx::transform(
+                                       [res](const drag &d) mutable
+                                       {
+                                         auto &plot = res.get().plot;
+                                         if (auto s = slider_at(plot, d.from))
+                                         {
+                                           move_slider(plot, *s, d.to);
+                                         }
+                                         return unit{};
+                                       });
+
                auto updates = view_updates | rx::merge(screen_updates);
                return frames | rx::observe_on(on_run_loop)
                       | rx::with_latest_from(
-                          [res](unit, unit)
+                          [res](unit, unit) mutable
                           {
+                            poll(res.get().plot);
                             draw(const_get(res).plot);
                             return unit{};
                           },
                           updates)
-                      | rx::merge(drag_renderer);
+                      | rx::merge(drag_renderer) | rx::merge(slider_moves);
              })
          | rx::subscribe_on(on_run_loop);
 }
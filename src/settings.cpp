@@ -31,6 +31,51 @@ std::string to_string_(const data_type &d)
   return "";
 }
 
+template <>
+std::string to_string_(const datafile_engine &e)
+{
+  switch (e)
+  {
+  case datafile_engine::cpu:
+    return "cpu";
+  case datafile_engine::gpu:
+    return "gpu";
+  }
+  return "";
+}
+
+template <>
+std::string to_string_(const evaluation_setting &e)
+{
+  switch (e.engine)
+  {
+  case expression_engine::transform_feedback:
+    return "feedback";
+  case expression_engine::compute:
+    return fmt::format("compute {}", e.workgroup_size);
+  }
+  return "";
+}
+
+template <>
+std::string to_string_(const sampling_setting &s)
+{
+  return s.adaptive ? fmt::format("adaptive {}", s.max_points) : "uniform"s;
+}
+
+template <>
+std::string to_string_(const precision_setting &p)
+{
+  switch (p)
+  {
+  case precision_setting::single:
+    return "single";
+  case precision_setting::fp64:
+    return "double";
+  }
+  return "";
+}
+
 template <>
 std::string to_string_(const samples_setting &setting)
 {
@@ -116,6 +161,18 @@ multiplot_setting default_value<settings_id::multiplot>()
   return {1, 1};
 }
 
+template <>
+uint32_t default_value<settings_id::evaluation_budget>()
+{
+  return static_cast<uint32_t>(evaluation_setting().budget >> 20);
+}
+
+template <>
+uint32_t default_value<settings_id::datafile_cache>()
+{
+  return 512;
+}
+
 template <settings_id id>
 settings_type_t<id> place = default_value<id>();
 
@@ -207,8 +264,19 @@ const multiplot_setting &multiplot() { return place<settings_id::multiplot>; }
 namespace datafile
 {
 char separator() { return place<settings_id::datafile_separator>; }
+datafile_engine engine() { return place<settings_id::datafile_engine>; }
+std::size_t cache() { return static_cast<std::size_t>(place<settings_id::datafile_cache>) << 20; }
 } // namespace datafile
 
+evaluation_setting evaluation()
+{
+  auto e = place<settings_id::evaluation>;
+  e.budget = static_cast<std::size_t>(place<settings_id::evaluation_budget>) << 20;
+  return e;
+}
+sampling_setting sampling() { return place<settings_id::sampling>; }
+precision_setting precision() { return place<settings_id::precision>; }
+
 namespace palette
 {
 std::tuple<int, int, int> rgbformulae() { return place<settings_id::pallette_rgbformulae>; }
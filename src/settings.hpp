@@ -28,8 +28,15 @@ const multiplot_setting &multiplot();
 namespace datafile
 {
 char separator();
+datafile_engine engine();
+// in bytes
+std::size_t cache();
 }
 
+evaluation_setting evaluation();
+sampling_setting sampling();
+precision_setting precision();
+
 namespace palette
 {
 std::tuple<int, int, int> rgbformulae();
@@ -0,0 +1,294 @@
+#include "simplify.hpp"
+#include "parse_ast.hpp"
+#include "user_definitions.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+using namespace explot;
+
+expr simplify(const expr &e, std::span<const std::pair<std::string_view, double>> bindings);
+
+// Adds the simplified nodes of an expression to result. Folded nodes leave their arguments in
+// result, which are dropped when result is compacted.
+struct simplifier
+{
+  const expr &e;
+  // the literal arguments of a user function, whose body is simplified
+  std::span<const std::pair<std::string_view, double>> bindings;
+  expr &result;
+  // the node in result of every node of e
+  std::vector<uint32_t> nodes{};
+
+  std::optional<double> literal_value(uint32_t node) const
+  {
+    const auto &n = result.nodes[node];
+    return n.op == expr_op::literal ? std::optional(n.value) : std::nullopt;
+  }
+
+  bool is_literal(uint32_t node, double value) const { return literal_value(node) == value; }
+
+  uint32_t negate(uint32_t node) { return result.add(expr_op::neg, std::array{node}); }
+
+  uint32_t simplify(const expr_node &n)
+  {
+    const auto args = e.args_of(n);
+    auto arg = [&](std::size_t i) { return nodes[args[i]]; };
+    switch (n.op)
+    {
+    case expr_op::literal:
+      return result.add_literal(n.value);
+    case expr_op::variable:
+      if (auto it = std::ranges::find(bindings, std::string_view(e.name_of(n)),
+                                      &std::pair<std::string_view, double>::first);
+          it != bindings.end())
+      {
+        return result.add_literal(it->second);
+      }
+      return result.add(expr_op::variable, {}, result.add_name(e.name_of(n)));
+    case expr_op::column:
+    case expr_op::user_variable:
+      return result.add(n.op, {}, n.idx);
+    case expr_op::neg:
+      if (auto v = literal_value(arg(0)))
+      {
+        return result.add_literal(-*v);
+      }
+      else if (const auto &inner = result.nodes[arg(0)]; inner.op == expr_op::neg)
+      {
+        return result.args_of(inner)[0];
+      }
+      return negate(arg(0));
+    case expr_op::add:
+    case expr_op::sub:
+    case expr_op::mul:
+    case expr_op::div:
+      return simplify_arithmetic(n.op, arg(0), arg(1));
+    case expr_op::less:
+    case expr_op::less_equal:
+    case expr_op::greater:
+    case expr_op::greater_equal:
+    case expr_op::equal:
+    case expr_op::not_equal:
+    case expr_op::logical_and:
+    case expr_op::logical_or:
+      return simplify_logic(n.op, arg(0), arg(1));
+    case expr_op::logical_not:
+      if (auto v = literal_value(arg(0)))
+      {
+        return result.add_literal(truth<double>(*v == 0.0));
+      }
+      return result.add(n.op, std::array{arg(0)});
+    case expr_op::select:
+      // only the branch of a literal condition is evaluated
+      if (auto v = literal_value(arg(0)))
+      {
+        return *v != 0.0 ? arg(1) : arg(2);
+      }
+      else if (arg(1) == arg(2))
+      {
+        return arg(1);
+      }
+      return result.add(n.op, std::array{arg(0), arg(1), arg(2)});
+    case expr_op::unary_call:
+      if (auto v = literal_value(arg(0)))
+      {
+        auto f = find_unary_function_fp64(e.name_of(n));
+        assert(f.has_value());
+        return result.add_literal((*f)(*v));
+      }
+      return result.add(n.op, std::array{arg(0)}, result.add_name(e.name_of(n)));
+    case expr_op::binary_call:
+      return simplify_call(e.name_of(n), arg(0), arg(1));
+    case expr_op::user_call:
+      return simplify_user_call(n.idx, args);
+    }
+    assert(false);
+    return 0;
+  }
+
+  uint32_t simplify_arithmetic(expr_op op, uint32_t lhs, uint32_t rhs)
+  {
+    const auto l = literal_value(lhs);
+    const auto r = literal_value(rhs);
+    switch (op)
+    {
+    case expr_op::add:
+      if (l && r)
+      {
+        return result.add_literal(*l + *r);
+      }
+      else if (is_literal(lhs, 0.0))
+      {
+        return rhs;
+      }
+      else if (is_literal(rhs, 0.0))
+      {
+        return lhs;
+      }
+      break;
+    case expr_op::sub:
+      if (l && r)
+      {
+        return result.add_literal(*l - *r);
+      }
+      else if (is_literal(lhs, 0.0))
+      {
+        return negate(rhs);
+      }
+      else if (is_literal(rhs, 0.0))
+      {
+        return lhs;
+      }
+      break;
+    case expr_op::mul:
+      if (l && r)
+      {
+        return result.add_literal(*l * *r);
+      }
+      else if (is_literal(lhs, 1.0))
+      {
+        return rhs;
+      }
+      else if (is_literal(rhs, 1.0))
+      {
+        return lhs;
+      }
+      else if (is_literal(lhs, -1.0))
+      {
+        return negate(rhs);
+      }
+      else if (is_literal(rhs, -1.0))
+      {
+        return negate(lhs);
+      }
+      break;
+    case expr_op::div:
+      if (l && r)
+      {
+        return result.add_literal(*l / *r);
+      }
+      else if (is_literal(rhs, 1.0))
+      {
+        return lhs;
+      }
+      break;
+    default:
+      assert(false);
+    }
+    return result.add(op, std::array{lhs, rhs});
+  }
+
+  uint32_t simplify_logic(expr_op op, uint32_t lhs, uint32_t rhs)
+  {
+    const auto l = literal_value(lhs);
+    const auto r = literal_value(rhs);
+    if (!l || !r)
+    {
+      return result.add(op, std::array{lhs, rhs});
+    }
+    switch (op)
+    {
+    case expr_op::less:
+      return result.add_literal(truth<double>(*l < *r));
+    case expr_op::less_equal:
+      return result.add_literal(truth<double>(*l <= *r));
+    case expr_op::greater:
+      return result.add_literal(truth<double>(*l > *r));
+    case expr_op::greater_equal:
+      return result.add_literal(truth<double>(*l >= *r));
+    case expr_op::equal:
+      return result.add_literal(truth<double>(*l == *r));
+    case expr_op::not_equal:
+      return result.add_literal(truth<double>(*l != *r));
+    case expr_op::logical_and:
+      return result.add_literal(truth<double>(*l != 0.0 && *r != 0.0));
+    case expr_op::logical_or:
+      return result.add_literal(truth<double>(*l != 0.0 || *r != 0.0));
+    default:
+      assert(false);
+      return 0;
+    }
+  }
+
+  uint32_t simplify_call(const std::string &name, uint32_t arg1, uint32_t arg2)
+  {
+    const auto v1 = literal_value(arg1);
+    const auto v2 = literal_value(arg2);
+    if (v1 && v2)
+    {
+      auto f = find_binary_function_fp64(name);
+      assert(f.has_value());
+      return result.add_literal((*f)(*v1, *v2));
+    }
+    else if (name == "pow" && v2)
+    {
+      if (*v2 == 0.0)
+      {
+        return result.add_literal(1.0);
+      }
+      else if (*v2 == 1.0)
+      {
+        return arg1;
+      }
+      else if (*v2 == 2.0)
+      {
+        return result.add(expr_op::mul, std::array{arg1, arg1});
+      }
+    }
+    return result.add(expr_op::binary_call, std::array{arg1, arg2}, result.add_name(name));
+  }
+
+  uint32_t simplify_user_call(uint32_t idx, std::span<const uint32_t> args)
+  {
+    auto call_args = std::vector<uint32_t>();
+    call_args.reserve(args.size());
+    for (auto a : args)
+    {
+      call_args.push_back(nodes[a]);
+    }
+
+    // a call with literal arguments is evaluated if the body is constant for them
+    const auto &def = get_definition(idx);
+    if (std::ranges::all_of(call_args, [&](uint32_t a) { return literal_value(a).has_value(); }))
+    {
+      auto inner_bindings = std::vector<std::pair<std::string_view, double>>();
+      for (auto i = 0uz; i < call_args.size(); ++i)
+      {
+        inner_bindings.emplace_back(def.params->at(i), *literal_value(call_args[i]));
+      }
+      const auto body = ::simplify(def.body, inner_bindings);
+      const auto &root = body.nodes[body.root()];
+      if (root.op == expr_op::literal)
+      {
+        return result.add_literal(root.value);
+      }
+    }
+    return result.add(expr_op::user_call, call_args, idx);
+  }
+};
+
+expr simplify(const expr &e, std::span<const std::pair<std::string_view, double>> bindings)
+{
+  auto folded = expr();
+  auto s = simplifier{e, bindings, folded};
+  s.nodes.reserve(e.nodes.size());
+  for (const auto &n : e.nodes)
+  {
+    s.nodes.push_back(s.simplify(n));
+  }
+  auto result = expr();
+  result.append(folded, s.nodes.back());
+  return result;
+}
+} // namespace
+
+namespace explot
+{
+expr simplify(const expr &e) { return ::simplify(e, {}); }
+} // namespace explot
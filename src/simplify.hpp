@@ -0,0 +1,10 @@
+#pragma once
+
+#include "commands.hpp"
+
+namespace explot
+{
+// Folds literal subexpressions and removes identities like x*1 and x+0. pow(x, 2) becomes x*x.
+// User variables are kept, they are uniforms in shaders and can change without a new program.
+expr simplify(const expr &e);
+} // namespace explot
@@ -0,0 +1,139 @@
+#include "sliders.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include "colors.hpp"
+
+namespace
+{
+using namespace explot;
+
+constexpr auto track_width = 200.0f;
+constexpr auto slider_height = 35.0f;
+constexpr auto margin = 20.0f;
+// the track is picked a bit above and below the line
+constexpr auto pick_distance = 8.0f;
+
+std::string glyphs_for_bindings(std::span<const variable_binding> bindings)
+{
+  auto glyphs = std::string(" =.-+e0123456789naif");
+  for (const auto &b : bindings)
+  {
+    glyphs += get_definition(b.variable).name;
+  }
+  std::ranges::sort(glyphs);
+  glyphs.erase(std::unique(glyphs.begin(), glyphs.end()), glyphs.end());
+  return glyphs;
+}
+
+seq_data_desc make_track_data(gl_id vbo)
+{
+  static constexpr float coords[] = {0.0f, 0.0f, 1.0f, 0.0f};
+  return data_for_span(vbo, coords, 2);
+}
+
+seq_data_desc make_knob_data(gl_id vbo)
+{
+  static constexpr float coord[] = {0.0f, 0.0f};
+  return data_for_span(vbo, coord, 2);
+}
+
+float current_value(const variable_binding &b)
+{
+  return constant_value(b.variable).value_or(b.lower);
+}
+
+void update_knob(const sliders &s, const slider &sl)
+{
+  const auto t = std::clamp((sl.value - sl.binding.lower) / (sl.binding.upper - sl.binding.lower),
+                            0.0f, 1.0f);
+  const auto x = sl.track_screen.lower_bounds.x + t * track_width;
+  const auto y = 0.5f * (sl.track_screen.lower_bounds.y + sl.track_screen.upper_bounds.y);
+  const auto knob_rect = rect{.lower_bounds = {x - 1.0f, y - 1.0f, -1.0f},
+                              .upper_bounds = {x + 1.0f, y + 1.0f, 1.0f}};
+  update(sl.knob, transforms_2d{.phase_to_screen = transform(clip_rect, knob_rect),
+                                .screen_to_clip = s.screen_to_clip});
+}
+} // namespace
+
+namespace explot
+{
+slider::slider(const variable_binding &b)
+    : binding(b), value(current_value(b)), track_vbo(make_vbo()),
+      track(track_vbo, make_track_data(track_vbo), 1.0f, axis_color), knob_vbo(make_vbo()),
+      knob(knob_vbo, make_knob_data(knob_vbo), 1.0f, selection_color, 11.0f)
+{
+}
+
+sliders::sliders(std::span<const variable_binding> bindings)
+    : font(make_font_atlas(glyphs_for_bindings(bindings))), screen_to_clip(1.0f)
+{
+  items.reserve(bindings.size());
+  for (const auto &b : bindings)
+  {
+    items.emplace_back(b);
+  }
+  update_values(*this);
+}
+
+void update(sliders &s, const rect &plot_screen, const glm::mat4 &screen_to_clip)
+{
+  s.screen_to_clip = screen_to_clip;
+  for (auto i = 0uz; i < s.items.size(); ++i)
+  {
+    auto &sl = s.items[i];
+    const auto x = plot_screen.lower_bounds.x + margin;
+    const auto y = plot_screen.upper_bounds.y - margin - static_cast<float>(i + 1) * slider_height;
+    sl.track_screen = rect{.lower_bounds = {x, y - pick_distance, -1.0f},
+                           .upper_bounds = {x + track_width, y + pick_distance, 1.0f}};
+    const auto line_rect = rect{.lower_bounds = {x, y - 1.0f, -1.0f},
+                                .upper_bounds = {x + track_width, y + 1.0f, 1.0f}};
+    update(sl.track, transforms_2d{.phase_to_screen = transform(rect{.lower_bounds = {0, -1, -1},
+                                                                      .upper_bounds = {1, 1, 1}},
+                                                                 line_rect),
+                                   .screen_to_clip = screen_to_clip});
+    update(sl.label, {x, y + slider_height - pick_distance, 0.0f}, {0.0f, 1.0f}, screen_to_clip);
+    update_knob(s, sl);
+  }
+}
+
+void update_values(sliders &s)
+{
+  for (auto &sl : s.items)
+  {
+    sl.value = current_value(sl.binding);
+    update(sl.label, fmt::format("{} = {:.4g}", get_definition(sl.binding.variable).name, sl.value),
+           s.font, text_color);
+    // the anchor depends on the bounds of the text
+    update(sl.label, sl.label.offset, sl.label.anchor, s.screen_to_clip);
+    update_knob(s, sl);
+  }
+}
+
+std::optional<std::size_t> slider_at(const sliders &s, glm::vec2 position)
+{
+  for (auto i = 0uz; i < s.items.size(); ++i)
+  {
+    if (contains(s.items[i].track_screen, position))
+    {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+float value_at(const slider &s, glm::vec2 position)
+{
+  const auto t = std::clamp((position.x - s.track_screen.lower_bounds.x) / track_width, 0.0f, 1.0f);
+  return s.binding.lower + t * (s.binding.upper - s.binding.lower);
+}
+
+void draw(const sliders &s)
+{
+  for (const auto &sl : s.items)
+  {
+    draw(sl.track);
+    draw(sl.knob);
+    draw(sl.label);
+  }
+}
+} // namespace explot
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <vector>
+#include "font_atlas.hpp"
+#include "gl-handle.hpp"
+#include "line_drawing.hpp"
+#include "point_drawing.hpp"
+#include "rect.hpp"
+#include "user_definitions.hpp"
+
+namespace explot
+{
+// a slider for a variable of a bind command
+struct slider
+{
+  variable_binding binding;
+  float value;
+  vbo_handle track_vbo;
+  lines_state_2d track;
+  vbo_handle knob_vbo;
+  points_2d_state knob;
+  gl_string label;
+  // the track in screen coordinates
+  rect track_screen;
+
+  slider(const variable_binding &b);
+};
+
+// Sliders are stacked in the upper left corner of the plot screen.
+struct sliders
+{
+  font_atlas font;
+  std::vector<slider> items;
+  glm::mat4 screen_to_clip;
+
+  sliders(std::span<const variable_binding> bindings);
+};
+
+void update(sliders &s, const rect &plot_screen, const glm::mat4 &screen_to_clip);
+// moves knobs and changes labels for the current values of the variables
+void update_values(sliders &s);
+// the index of the slider, whose track contains position in screen coordinates
+std::optional<std::size_t> slider_at(const sliders &s, glm::vec2 position);
+// the value of the variable of a slider for a position of the knob in screen coordinates
+float value_at(const slider &s, glm::vec2 position);
+void draw(const sliders &s);
+} // namespace explot
@@ -218,7 +218,10 @@ void normals(gl_id vbo, const grid_data_desc &d, gl_id out)
   // glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
 }
 
-auto program_for_surface() { return make_program(nullptr, vertex_shader_src, fragment_shader_src); }
+auto program_for_surface()
+{
+  return clone_program(make_program(nullptr, vertex_shader_src, fragment_shader_src));
+}
 
 constexpr auto x = "x";
 constexpr auto one_minus_x = "1 - x";
@@ -232,7 +235,8 @@ auto program_for_pm3d_implicit_color()
   auto fragment_shader =
       fmt::format(pm3d_fragment_shader, rformula, gformula, bformula, ridx < 0 ? one_minus_x : x,
                   gidx < 0 ? one_minus_x : x, bidx < 0 ? one_minus_x : x);
-  return make_program(nullptr, pm3d_implicit_color_vertex_shader, fragment_shader.c_str());
+  return clone_program(
+      make_program(nullptr, pm3d_implicit_color_vertex_shader, fragment_shader.c_str()));
 }
 
 auto program_for_pm3d_explicit_color()
@@ -245,7 +249,8 @@ auto program_for_pm3d_explicit_color()
       fmt::format(pm3d_fragment_shader, rformula, gformula, bformula, ridx < 0 ? one_minus_x : x,
                   gidx < 0 ? one_minus_x : x, bidx < 0 ? one_minus_x : x);
 
-  return make_program(nullptr, pm3d_explicit_color_vertex_shader, fragment_shader.c_str());
+  return clone_program(
+      make_program(nullptr, pm3d_explicit_color_vertex_shader, fragment_shader.c_str()));
 }
 
 void set_phase_to_clip(gl_id program, const glm::mat4 &phase_to_clip)
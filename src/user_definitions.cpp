@@ -1,37 +1,77 @@
 #include "user_definitions.hpp"
+#include "expr_vm.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
 #include <ranges>
+#include <unordered_map>
+#include <utility>
 namespace
 {
 using namespace explot;
 
+// an animation sweeps from from to to in sweep_duration and back
+constexpr auto sweep_duration = 5.0f;
+
+struct animation
+{
+  uint32_t variable;
+  float from;
+  float to;
+  float fps;
+  std::optional<std::chrono::steady_clock::time_point> start = std::nullopt;
+  int64_t last_step = -1;
+};
+
+// The repl adds definitions and the ui thread changes variables, while both read them, so every
+// access is guarded by definitions_mutex. It is never held while another lock is taken.
+std::mutex definitions_mutex;
 std::vector<user_definition> definitions;
-} // namespace
+std::atomic<uint32_t> version = 0;
+// Constant values are evaluated by every plot for every function and variable whenever the version
+// changes, e.g. every frame of an animation, so they are cached for the version.
+std::mutex constants_mutex;
+std::unordered_map<uint32_t, std::optional<float>> constants;
+uint32_t constants_version = 0;
+// bindings and animations are used by the ui thread
+std::mutex parameters_mutex;
+std::vector<variable_binding> bindings;
+std::vector<animation> animations;
 
-namespace explot
+uint32_t define_variable(const std::string &name, float value)
 {
-void add_definition(user_definition def) { definitions.push_back(std::move(def)); }
+  if (auto idx = find_user_variable(name))
+  {
+    return *idx;
+  }
+  add_definition(user_definition{name, std::nullopt, literal_expr{value}});
+  return *find_user_variable(name);
+}
 
-std::optional<uint32_t> find_user_function(std::string_view name)
+std::optional<float> constant_body_value(const expr &body)
 {
-  auto rdefs = std::views::reverse(definitions);
-  auto it = std::ranges::find_if(rdefs, [&](const user_definition &d)
-                                 { return d.name == name && d.params.has_value(); });
-  if (it != rdefs.end())
+  // like variables changed by sliders and animations
+  if (body.nodes.size() == 1 && body.nodes.front().op == expr_op::literal)
   {
-    return std::distance(definitions.begin(), it.base()) - 1;
+    return static_cast<float>(body.nodes.front().value);
   }
-  else
+  const auto program = compile({&body, 1});
+  if (!program.inputs.empty() || program.row_register)
   {
     return std::nullopt;
   }
+  auto value = 0.0f;
+  evaluate(program, {}, 0, 1, {&value, 1});
+  return value;
 }
 
-std::optional<uint32_t> find_user_variable(std::string_view name)
+template <typename P>
+std::optional<uint32_t> find_last(P pred)
 {
+  auto lock = std::lock_guard(definitions_mutex);
   auto rdefs = std::views::reverse(definitions);
-  auto it = std::ranges::find_if(rdefs, [&](const user_definition &d)
-                                 { return d.name == name && !d.params.has_value(); });
+  auto it = std::ranges::find_if(rdefs, pred);
   if (it != rdefs.end())
   {
     return std::distance(definitions.begin(), it.base()) - 1;
@@ -42,10 +82,172 @@ std::optional<uint32_t> find_user_variable(std::string_view name)
   }
 }
 
-const user_definition &get_definition(uint32_t idx)
+struct variables_visitor
+{
+  std::vector<uint32_t> &variables;
+  // definitions, which were visited already
+  std::vector<uint32_t> &visited;
+  // definitions_mutex is held
+
+  bool visit(uint32_t idx)
+  {
+    if (std::ranges::find(visited, idx) != visited.end())
+    {
+      return false;
+    }
+    visited.push_back(idx);
+    return true;
+  }
+
+  void operator()(const expr &e)
+  {
+    for (const auto &n : e.nodes)
+    {
+      if (n.op == expr_op::user_call && visit(n.idx))
+      {
+        (*this)(definitions[n.idx].body);
+      }
+      else if (n.op == expr_op::user_variable && visit(n.idx))
+      {
+        variables.push_back(n.idx);
+        (*this)(definitions[n.idx].body);
+      }
+    }
+  }
+};
+} // namespace
+
+namespace explot
+{
+void add_definition(user_definition def)
+{
+  if (auto idx = find_user_variable(def.name); idx && !def.params && constant_value(*idx))
+  {
+    auto uses = std::vector<uint32_t>();
+    used_variables(def.body, uses);
+    // a = a + 1 refers to the old a, which can not be replaced. The body does not use the
+    // variable, so it is as constant before as after the replacement.
+    if (std::ranges::find(uses, *idx) == uses.end() && constant_body_value(def.body))
+    {
+      {
+        auto lock = std::lock_guard(definitions_mutex);
+        definitions[*idx] = std::move(def);
+      }
+      auto lock = std::lock_guard(parameters_mutex);
+      std::erase_if(animations, [&](const animation &a) { return a.variable == *idx; });
+      ++version;
+      return;
+    }
+  }
+  auto lock = std::lock_guard(definitions_mutex);
+  definitions.push_back(std::move(def));
+}
+
+std::optional<uint32_t> find_user_function(std::string_view name)
 {
+  return find_last([&](const user_definition &d)
+                   { return d.name == name && d.params.has_value(); });
+}
+
+std::optional<uint32_t> find_user_variable(std::string_view name)
+{
+  return find_last([&](const user_definition &d)
+                   { return d.name == name && !d.params.has_value(); });
+}
+
+user_definition get_definition(uint32_t idx)
+{
+  auto lock = std::lock_guard(definitions_mutex);
   assert(idx < definitions.size());
   return definitions[idx];
 }
 
+std::optional<float> constant_value(uint32_t idx)
+{
+  const auto current = version.load();
+  {
+    auto lock = std::lock_guard(constants_mutex);
+    if (auto it = constants.find(idx); constants_version == current && it != constants.end())
+    {
+      return it->second;
+    }
+  }
+  const auto def = get_definition(idx);
+  const auto value = def.params ? std::nullopt : constant_body_value(def.body);
+  // the value is only cached, if no variable changed while it was evaluated
+  auto lock = std::lock_guard(constants_mutex);
+  if (version.load() == current)
+  {
+    if (constants_version != current)
+    {
+      constants.clear();
+      constants_version = current;
+    }
+    constants.insert_or_assign(idx, value);
+  }
+  return value;
+}
+
+void used_variables(const expr &e, std::vector<uint32_t> &variables)
+{
+  auto visited = std::vector<uint32_t>();
+  auto lock = std::lock_guard(definitions_mutex);
+  variables_visitor{variables, visited}(e);
+}
+
+uint32_t definitions_version() { return version.load(); }
+
+void set_variable(uint32_t idx, float value)
+{
+  {
+    auto lock = std::lock_guard(definitions_mutex);
+    assert(idx < definitions.size() && !definitions[idx].params);
+    definitions[idx].body = literal_expr{value};
+  }
+  ++version;
+}
+
+void bind_variable(const bind_command &cmd)
+{
+  const auto idx = define_variable(cmd.name, cmd.lower);
+  auto lock = std::lock_guard(parameters_mutex);
+  std::erase_if(bindings, [&](const variable_binding &b) { return b.variable == idx; });
+  bindings.push_back(variable_binding{idx, cmd.lower, cmd.upper});
+}
+
+std::vector<variable_binding> variable_bindings()
+{
+  auto lock = std::lock_guard(parameters_mutex);
+  return bindings;
+}
+
+void animate_variable(const animate_command &cmd)
+{
+  const auto idx = define_variable(cmd.name, cmd.from);
+  auto lock = std::lock_guard(parameters_mutex);
+  std::erase_if(animations, [&](const animation &a) { return a.variable == idx; });
+  animations.push_back(animation{idx, cmd.from, cmd.to, cmd.fps});
+}
+
+void advance_animations(std::chrono::steady_clock::time_point now)
+{
+  auto lock = std::lock_guard(parameters_mutex);
+  for (auto &a : animations)
+  {
+    if (!a.start)
+    {
+      a.start = now;
+    }
+    const auto elapsed = std::chrono::duration<float>(now - *a.start).count();
+    const auto step = static_cast<int64_t>(std::floor(elapsed * a.fps));
+    if (step == a.last_step)
+    {
+      continue;
+    }
+    a.last_step = step;
+    const auto phase = std::fmod(static_cast<float>(step) / a.fps, 2.0f * sweep_duration);
+    const auto t = phase <= sweep_duration ? phase / sweep_duration : 2.0f - phase / sweep_duration;
+    set_variable(a.variable, a.from + t * (a.to - a.from));
+  }
+}
 } // namespace explot
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <string_view>
 #include <optional>
+#include <vector>
 #include "commands.hpp"
 
 namespace explot
@@ -10,6 +12,35 @@ namespace explot
 std::optional<uint32_t> find_user_function(std::string_view name);
 std::optional<uint32_t> find_user_variable(std::string_view name);
 
+// A constant variable, which gets another constant value, is changed in place, so that plots
+// using it are evaluated again with the new value. Other definitions are added.
 void add_definition(user_definition def);
-const user_definition &get_definition(uint32_t idx);
+// a copy, because the ui thread changes variables while the repl adds definitions
+user_definition get_definition(uint32_t idx);
+
+// the value of a variable, which depends on no variables like x and no columns
+std::optional<float> constant_value(uint32_t idx);
+// the variables used by e, directly or through other definitions
+void used_variables(const expr &e, std::vector<uint32_t> &variables);
+// incremented whenever a variable is changed in place
+uint32_t definitions_version();
+// changes a constant variable in place, like a definition with a literal does
+void set_variable(uint32_t idx, float value);
+
+struct variable_binding
+{
+  uint32_t variable;
+  float lower;
+  float upper;
+
+  bool operator==(const variable_binding &) const = default;
+};
+
+// Variables, which do not exist yet, are defined with the lower bound or the start of the
+// animation.
+void bind_variable(const bind_command &cmd);
+std::vector<variable_binding> variable_bindings();
+void animate_variable(const animate_command &cmd);
+// Sets animated variables to their values at now. They change at most fps times per second.
+void advance_animations(std::chrono::steady_clock::time_point now);
 } // namespace explot